@@ -0,0 +1,55 @@
+//
+//  AudioConditioner.h
+//  HoundifySDK Sample App (Objective-C)
+//
+//  Created by SoundHound on 10/19/26.
+//  Copyright (c) 2026 SoundHound, Inc. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#pragma mark - AudioConditioner
+
+/**
+ Cleans up 16 bit linear PCM audio before it is passed to the SDK in raw mode.
+
+ Each buffer is run through a high-pass filter, which removes low frequency rumble such as
+ road and engine noise. The conditioner then keeps a running estimate of the background
+ noise level. Buffers well above it are treated as speech and brought towards targetLevel.
+ Other buffers are treated as noise: they are never boosted, and are pulled down by
+ noiseAttenuation.
+
+ All processing uses Accelerate, in place and without allocating, so it can run on the audio
+ thread. An instance keeps filter and gain state between buffers and must only be used from one
+ thread at a time.
+ */
+@interface AudioConditioner : NSObject
+
+- (instancetype)initWithSampleRate:(double)sampleRate;
+
+/** The level, in dBFS, that speech is brought towards. Default -20. */
+@property (nonatomic, assign) float targetLevel;
+
+/** The largest boost, in dB, applied to quiet speech. Default 18. */
+@property (nonatomic, assign) float maximumGain;
+
+/** How far above the background noise, in dB, a buffer must be to count as speech. Default 10. */
+@property (nonatomic, assign) float speechMargin;
+
+/** Attenuation, in dB, applied to buffers treated as noise. Default 12. */
+@property (nonatomic, assign) float noiseAttenuation;
+
+/** The number of buffers processed, and the total time spent processing them. */
+@property (nonatomic, readonly) NSUInteger processedBufferCount;
+@property (nonatomic, readonly) NSTimeInterval processingTime;
+
+/** Sets processedBufferCount and processingTime back to zero. */
+- (void)resetStatistics;
+
+/**
+ Conditions data in place. Buffers longer than 4096 samples, more than Core Audio delivers in one
+ render callback, are left unchanged.
+ */
+- (void)processAudioData:(NSMutableData *)data;
+
+@end
@@ -0,0 +1,180 @@
+//
+//  AudioConditioner.m
+//  HoundifySDK Sample App (Objective-C)
+//
+//  Created by SoundHound on 10/19/26.
+//  Copyright (c) 2026 SoundHound, Inc. All rights reserved.
+//
+
+#import "AudioConditioner.h"
+
+@import Accelerate;
+@import QuartzCore;
+
+#define HIGH_PASS_FREQUENCY                     120.0
+#define GAIN_ATTACK_TIME                        0.01
+#define GAIN_RELEASE_TIME                       0.5
+#define NOISE_GATE_OPEN_TIME                    0.01
+#define NOISE_GATE_CLOSE_TIME                   0.2
+
+// The scratch buffer is allocated once, for the largest buffer Core Audio delivers in one render
+// callback (the default kAudioUnitProperty_MaximumFramesPerSlice)
+#define MAXIMUM_FRAME_COUNT                     4096
+
+// Time constants for the background noise estimate to rise towards the current level, in quiet
+// audio and in audio classified as speech, as in VoiceActivityDetector
+#define NOISE_TIME_CONSTANT                     2.0
+#define LOUD_NOISE_TIME_CONSTANT                10.0
+
+#pragma mark - AudioConditioner
+
+@interface AudioConditioner()
+
+@property(nonatomic, assign) double sampleRate;
+
+@property(nonatomic, assign) vDSP_biquad_Setup highPass;
+@property(nonatomic, assign) float* highPassDelay;
+
+@property(nonatomic, assign) float* samples;
+
+@property(nonatomic, assign) BOOL hasNoiseLevel;
+@property(nonatomic, assign) float noiseLevel;
+
+@property(nonatomic, assign) float agcGain;
+@property(nonatomic, assign) float speechAmount;
+@property(nonatomic, assign) float gain;
+
+@property(nonatomic, assign, readwrite) NSUInteger processedBufferCount;
+@property(nonatomic, assign, readwrite) NSTimeInterval processingTime;
+
+@end
+
+@implementation AudioConditioner
+
+- (instancetype)initWithSampleRate:(double)sampleRate
+{
+    self = [super init];
+
+    if (self)
+    {
+        self.sampleRate = sampleRate;
+
+        self.targetLevel = -20.0;
+        self.maximumGain = 18.0;
+        self.speechMargin = 10.0;
+        self.noiseAttenuation = 12.0;
+
+        // Second order Butterworth high-pass, from the Audio EQ Cookbook
+        double w0 = 2.0 * M_PI * HIGH_PASS_FREQUENCY / sampleRate;
+        double alpha = sin(w0) / (2.0 * M_SQRT1_2);
+        double a0 = 1.0 + alpha;
+
+        const double coefficients[5] = {
+            (1.0 + cos(w0)) / 2.0 / a0,
+            -(1.0 + cos(w0)) / a0,
+            (1.0 + cos(w0)) / 2.0 / a0,
+            -2.0 * cos(w0) / a0,
+            (1.0 - alpha) / a0,
+        };
+
+        self.highPass = vDSP_biquad_CreateSetup(coefficients, 1);
+        self.highPassDelay = calloc(4, sizeof(float));
+        self.samples = calloc(MAXIMUM_FRAME_COUNT, sizeof(float));
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    vDSP_biquad_DestroySetup(self.highPass);
+
+    free(self.highPassDelay);
+    free(self.samples);
+}
+
+- (void)resetStatistics
+{
+    self.processedBufferCount = 0;
+    self.processingTime = 0;
+}
+
+- (void)processAudioData:(NSMutableData *)data
+{
+    vDSP_Length count = data.length / sizeof(SInt16);
+
+    if (count == 0 || count > MAXIMUM_FRAME_COUNT)
+    {
+        return;
+    }
+
+    CFTimeInterval start = CACurrentMediaTime();
+
+    float* samples = self.samples;
+
+    vDSP_vflt16(data.bytes, 1, samples, 1, count);
+    vDSP_biquad(self.highPass, self.highPassDelay, samples, 1, samples, 1, count);
+
+    float rms = 0;
+
+    vDSP_rmsqv(samples, 1, &rms, count);
+
+    float level = 20.0f * log10f(MAX(rms / 32768.0f, 1e-6f));
+    NSTimeInterval duration = count / self.sampleRate;
+
+    if (!self.hasNoiseLevel)
+    {
+        self.noiseLevel = level;
+        self.hasNoiseLevel = YES;
+    }
+
+    BOOL speech = level > self.noiseLevel + self.speechMargin;
+
+    // Follow the background noise down immediately, and up slowly
+    if (level < self.noiseLevel)
+    {
+        self.noiseLevel = level;
+    }
+    else
+    {
+        NSTimeInterval timeConstant = speech ? LOUD_NOISE_TIME_CONSTANT : NOISE_TIME_CONSTANT;
+
+        self.noiseLevel += (level - self.noiseLevel) * MIN(duration / timeConstant, 1.0);
+    }
+
+    if (speech)
+    {
+        // Adapt the automatic gain towards the target level, turning it down quickly and up slowly
+        float agcTarget = MIN(self.targetLevel - level, self.maximumGain);
+        NSTimeInterval timeConstant = agcTarget < self.agcGain ? GAIN_ATTACK_TIME : GAIN_RELEASE_TIME;
+
+        self.agcGain += (agcTarget - self.agcGain) * (float)(1.0 - exp(-duration / timeConstant));
+    }
+
+    // Let speech through quickly when it starts, and suppress noise more slowly once it ends
+    NSTimeInterval gateTimeConstant = speech ? NOISE_GATE_OPEN_TIME : NOISE_GATE_CLOSE_TIME;
+
+    self.speechAmount += ((speech ? 1.0f : 0.0f) - self.speechAmount) * (float)(1.0 - exp(-duration / gateTimeConstant));
+
+    // Noise is never boosted, even when quiet speech is
+    float noiseGain = MIN(self.agcGain, 0.0f) - self.noiseAttenuation;
+    float previousGain = self.gain;
+
+    self.gain = self.speechAmount * self.agcGain + (1.0f - self.speechAmount) * noiseGain;
+
+    // Ramp from the previous gain across the buffer to avoid clicks
+    float startScale = powf(10.0f, previousGain / 20.0f);
+    float step = (powf(10.0f, self.gain / 20.0f) - startScale) / count;
+    float low = INT16_MIN;
+    float high = INT16_MAX;
+
+    vDSP_vrampmul(samples, 1, &startScale, &step, samples, 1, count);
+    vDSP_vclip(samples, 1, &low, &high, samples, 1, count);
+
+    vDSP_vfixr16(samples, 1, data.mutableBytes, 1, count);
+
+    self.processedBufferCount++;
+    self.processingTime += CACurrentMediaTime() - start;
+}
+
+@end
@@ -10,7 +10,8 @@
 
 #pragma mark - Callbacks
 
-typedef void (^AudioTesterDataHandler)(NSError* error, NSData* data);
+// Each callback receives a new buffer, which the handler may modify in place
+typedef void (^AudioTesterDataHandler)(NSError* error, NSMutableData* data);
 typedef void (^AudioTesterErrorHandler)(NSError* error);
 
 #pragma mark - Errors
@@ -293,7 +293,7 @@ OSStatus audioTesterRenderCallback(void* context, AudioUnitRenderActionFlags* ac
                 SInt16* buffer = bufferList->mBuffers[0].mData;
                 NSUInteger length = sizeof(SInt16) * frameCount;
                 
-                NSData* data = [NSData dataWithBytes:buffer length:length];
+                NSMutableData* data = [NSMutableData dataWithBytes:buffer length:length];
                 
                 if (self.handler) self.handler(nil, data);
             }
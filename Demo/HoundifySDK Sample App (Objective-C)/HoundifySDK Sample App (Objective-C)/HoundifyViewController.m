@@ -30,6 +30,10 @@
 @property (nonatomic, copy) NSString *updateText;
 @property (nonatomic, copy) NSAttributedString *responseText;
 
+// The query whose response is being displayed. Formatting finishes asynchronously, so results for
+// any other query are dropped.
+@property (nonatomic, strong) HoundVoiceSearchQuery *displayedQuery;
+
 @end
 
 @implementation HoundifyViewController
@@ -128,6 +132,8 @@
      }
                                                              completion:
      ^(HoundVoiceSearchQuery * _Nonnull query) {
+         self.displayedQuery = query;
+         
          if (query.error)
          {
              self.updateText = [NSString stringWithFormat:@"%@ %ld %@", query.error.domain, query.error.code, query.error.localizedDescription];
@@ -143,7 +149,12 @@
              if (specialExampleText) {
                  self.responseText = specialExampleText;
              } else {
-                 self.responseText = [JSONAttributedFormatter attributedStringFromObject:query.dictionary style:nil];
+                 // Format the response off the main thread, and drop it if another search has started since.
+                 [JSONAttributedFormatter attributedStringFromObject:query.dictionary style:nil queue:dispatch_get_main_queue() completion:^(NSAttributedString *attributedString) {
+                     if (query == self.displayedQuery) {
+                         self.responseText = attributedString;
+                     }
+                 }];
              }
 
              // Any properties from the documentation can be accessed through the keyed accessors, e.g.:
@@ -263,6 +274,7 @@
 
 - (void)resetTextView
 {
+    self.displayedQuery = nil;
     self.updateText = nil;
     self.responseText = nil;
 }
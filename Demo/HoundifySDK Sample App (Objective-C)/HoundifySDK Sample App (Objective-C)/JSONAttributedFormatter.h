@@ -27,4 +27,14 @@
 + (NSAttributedString*)attributedStringFromObject:(id)object
     style:(JSONAttributedFormatterStyle*)style;
 
+/**
+ Formats object on a background queue, then calls completion on queue.
+ Formatting a large response can take long enough to hold up rendering, so
+ prefer this to formatting on the main thread.
+ */
++ (void)attributedStringFromObject:(id)object
+    style:(JSONAttributedFormatterStyle*)style
+    queue:(dispatch_queue_t)queue
+    completion:(void (^)(NSAttributedString* attributedString))completion;
+
 @end
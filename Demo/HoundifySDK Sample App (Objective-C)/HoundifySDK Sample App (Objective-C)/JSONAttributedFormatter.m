@@ -67,6 +67,20 @@ typedef NS_ENUM(NSUInteger, JSONAttributedFormatterTokenType)
     return attributedString;
 }
 
++ (void)attributedStringFromObject:(id)object
+    style:(JSONAttributedFormatterStyle*)style
+    queue:(dispatch_queue_t)queue
+    completion:(void (^)(NSAttributedString* attributedString))completion
+{
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        NSAttributedString* attributedString = [JSONAttributedFormatter attributedStringFromObject:object style:style];
+        
+        dispatch_async(queue, ^{
+            completion(attributedString);
+        });
+    });
+}
+
 + (void)appendAttributedStringForObject:(id)object
     toAttributedString:(NSMutableAttributedString*)attributedString
     indentLevel:(NSInteger)indentLevel
@@ -11,10 +11,19 @@
 #import "UITabBarController+HoundifySample.h"
 #import "HoundDataCommandResult+Extras.h"
 #import "AudioTester.h"
+#import "VoiceActivityDetector.h"
+#import "SpeechGate.h"
+#import "AudioConditioner.h"
 @import HoundifySDK;
 @import AVFoundation;
 
 #define SAMPLE_RATE                             44100
+#define PARTIAL_TRANSCRIPT_INTERVAL             0.1
+#define STOP_RECORDING_WHEN_SAFE                0
+#define LOCAL_END_OF_SPEECH_DETECTION           0
+#define LEADING_SILENCE_GUARD_INTERVAL          0
+#define AUDIO_CONDITIONING                      0
+#define HOT_PHRASE_GUARD_INTERVAL               0.5
 
 typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
     RawVoiceSearchViewControllerSetupStateNotSetUp,
@@ -36,6 +45,22 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
 
 @property(nonatomic, strong) HoundVoiceSearchQuery *query;
 
+@property (nonatomic, strong) HoundDataPartialTranscript *pendingPartialTranscript;
+@property (nonatomic, assign) CFTimeInterval lastPartialTranscriptTime;
+@property (nonatomic, assign) NSUInteger partialTranscriptsReceived;
+@property (nonatomic, assign) NSUInteger partialTranscriptsDisplayed;
+@property (nonatomic, assign) CFTimeInterval partialTranscriptDisplayTime;
+
+@property (nonatomic, assign) CFTimeInterval cancelTime;
+
+@property (nonatomic, assign) BOOL localEndOfSpeechDetection;
+@property (atomic, strong) VoiceActivityDetector *endOfSpeechDetector;
+@property (nonatomic, strong) VoiceActivityDetector *ambientNoiseDetector;
+@property (atomic, strong) SpeechGate *leadingSilenceGate;
+@property (atomic, assign) BOOL finishRecordingRequested;
+@property (atomic, strong) SpeechGate *hotPhraseGate;
+@property (atomic, strong) AudioConditioner *audioConditioner;
+
 @property (nonatomic, readonly) NSString *explanatoryText;
 @property (nonatomic, copy) NSString *updateText;
 @property (nonatomic, copy) NSAttributedString *responseText;
@@ -82,6 +107,9 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
                                              selector:@selector(applicationWillResignActive:)
                                                  name:UIApplicationWillResignActiveNotification
                                                object:nil];
+    
+    // Hot phrase detection may have been switched on or off in Settings
+    [self updateHotPhraseGate];
 }
 
 
@@ -155,7 +183,7 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
     
     self.setupState = RawVoiceSearchViewControllerSetupStateSettingUpAudio;
     
-    [[AudioTester instance] startAudioWithSampleRate:SAMPLE_RATE dataHandler:^(NSError *error, NSData *data) {
+    [[AudioTester instance] startAudioWithSampleRate:SAMPLE_RATE dataHandler:^(NSError *error, NSMutableData *data) {
         if (error) {
             NSString *errorString = [NSString stringWithFormat:@"Audio Setup Error: %@", error.localizedDescription];
             self.updateText = errorString;
@@ -189,19 +217,157 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
              NSLog(@"%@", errorString);
              self.setupState = RawVoiceSearchViewControllerSetupStateNotSetUp;
          } else {
+             if (AUDIO_CONDITIONING) {
+                 self.audioConditioner = [[AudioConditioner alloc] initWithSampleRate:[AVAudioSession sharedInstance].sampleRate];
+             }
+             
              self.setupState = RawVoiceSearchViewControllerSetupStateSetUp;
+             [self startHotPhraseGate];
              [self refreshUI];
              [self refreshTextView];
          }
      }];
 }
 
-- (void)passAudioData:(NSData *)data {
+- (void)passAudioData:(NSMutableData *)data {
     
     // When using HoundVoiceSearch in raw mode, the application is responsible for continuously passing audio data
     // to the SDK
     
-    [[HoundVoiceSearch instance] writeRawAudioData:data];
+    // While a search is waiting for the user to start speaking, leadingSilenceGate holds the audio
+    // back, so that silence is not uploaded. The gate releases the audio from just before speech starts.
+    
+    // Between searches, hotPhraseGate does the same for the SDK's hot phrase spotter, so that the
+    // spotter only runs while someone might be speaking. The setting is checked on every buffer, because
+    // it can be switched off in Settings while the gate is installed.
+    
+    SpeechGate *gate = self.leadingSilenceGate;
+    
+    if (!gate && [HoundVoiceSearch instance].enableHotPhraseDetection) {
+        gate = self.hotPhraseGate;
+    }
+    
+    // The gates and endOfSpeechDetector measure speech against the background noise, so they see the
+    // audio before it is conditioned. Conditioning changes the level of the noise and would skew them.
+    
+    [self seedNoiseLevelOfDetector:gate.detector];
+    [self detectEndOfSpeechInAudioData:data];
+    [self trackAmbientNoiseInAudioData:data];
+    
+    NSArray<NSData *> *audio = gate ? [gate processAudioData:data] : @[data];
+    
+    // Noisy audio, such as audio recorded in a car, produces long, low confidence transcriptions.
+    // audioConditioner filters out low frequency noise and evens out the level of the audio before
+    // it reaches the SDK's phrase spotter and encoder. See AudioConditioner.h for its settings.
+    // It is off by default (AUDIO_CONDITIONING); measure transcription quality before enabling it.
+    
+    // The conditioner works in place on AudioTester's buffer, so it allocates nothing on the audio thread.
+    // A gate may hold on to the buffer, but it is conditioned here, before it is ever written.
+    
+    [self.audioConditioner processAudioData:data];
+    
+    for (NSData *buffer in audio) {
+        [[HoundVoiceSearch instance] writeRawAudioData:buffer];
+    }
+    
+    if (self.finishRecordingRequested) {
+        self.finishRecordingRequested = NO;
+        
+        [self releaseLeadingSilence];
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (self.query.state == HoundVoiceSearchQueryStateRecording) {
+                [self.query finishRecording];
+            }
+        });
+    }
+}
+
+- (void)trackAmbientNoiseInAudioData:(NSData *)data
+{
+    // Called on the audio thread, which is the only place ambientNoiseDetector is used.
+    
+    // Detectors created for a query start from this estimate instead of from the first buffer
+    // they see, which may be speech when a search starts mid-utterance, for example after the
+    // hot phrase.
+    
+    if (!self.ambientNoiseDetector) {
+        self.ambientNoiseDetector = [[VoiceActivityDetector alloc] initWithSampleRate:[AVAudioSession sharedInstance].sampleRate];
+        self.ambientNoiseDetector.leadingSilenceDuration = 0;
+        self.ambientNoiseDetector.maximumSpeechDuration = 0;
+    }
+    
+    [self.ambientNoiseDetector processAudioData:data];
+}
+
+- (void)releaseLeadingSilence
+{
+    // Called on the audio thread, before recording finishes. While the leading silence gate is
+    // closed it holds the most recent audio, which may include speech it has not recognized yet.
+    // Pass that on rather than finish the query without it.
+    
+    SpeechGate *gate = self.leadingSilenceGate;
+    
+    if (gate && !gate.isOpen) {
+        for (NSData *buffer in [gate open]) {
+            [[HoundVoiceSearch instance] writeRawAudioData:buffer];
+        }
+    }
+}
+
+- (void)finishRecording
+{
+    // The leading silence gate is only used on the audio thread, so let the audio thread release
+    // what it holds and then finish recording.
+    
+    if (self.leadingSilenceGate) {
+        self.finishRecordingRequested = YES;
+    } else {
+        [self.query finishRecording];
+    }
+}
+
+- (void)seedNoiseLevelOfDetector:(VoiceActivityDetector *)detector
+{
+    // Called on the audio thread.
+    
+    if (!detector.hasNoiseLevel && self.ambientNoiseDetector.hasNoiseLevel) {
+        [detector seedNoiseLevel:self.ambientNoiseDetector.noiseLevel];
+    }
+}
+
+- (void)detectEndOfSpeechInAudioData:(NSData *)data
+{
+    // Called on the audio thread.
+    
+    VoiceActivityDetector *detector = self.endOfSpeechDetector;
+    
+    if (!detector) {
+        return;
+    }
+    
+    [self seedNoiseLevelOfDetector:detector];
+    
+    VoiceActivityDetectorEvent event = [detector processAudioData:data];
+    
+    if (event != VoiceActivityDetectorEventSpeechEnded && event != VoiceActivityDetectorEventNoSpeech) {
+        return;
+    }
+    
+    self.endOfSpeechDetector = nil;
+    
+    [self releaseLeadingSilence];
+    
+    NSTimeInterval duration = detector.processedDuration;
+    
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (self.query.state == HoundVoiceSearchQueryStateRecording) {
+            NSLog(@"Local end of speech detected after %.0f ms%@", duration * 1000.0,
+                  event == VoiceActivityDetectorEventNoSpeech ? @" (no speech)" : @"");
+            
+            [self.query finishRecording];
+        }
+    });
 }
 
 - (void)startSearch
@@ -226,17 +392,143 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
     self.query.requestInfoBuilder.positionTime = lround([[NSDate date] timeIntervalSince1970]);
     self.query.requestInfoBuilder.positionHorizontalAccuracy = 10.0;
     
+    self.partialTranscriptsReceived = 0;
+    self.partialTranscriptsDisplayed = 0;
+    self.partialTranscriptDisplayTime = 0;
+    self.cancelTime = 0;
+    [self.audioConditioner resetStatistics];
+    self.finishRecordingRequested = NO;
+    
+    // Since the application has the raw audio, it can decide for itself when the user has
+    // finished speaking, instead of relying on the SDK. See VoiceActivityDetector.h for the
+    // settings that control how quickly end of speech is detected. maximumSpeechDuration also
+    // ends recording if the detector never hears the speech end, for example in rising noise.
+    
+    self.localEndOfSpeechDetection = LOCAL_END_OF_SPEECH_DETECTION && self.query.automaticEndOfSpeech;
+    
+    if (self.localEndOfSpeechDetection) {
+        self.query.automaticEndOfSpeech = NO;
+        self.endOfSpeechDetector = [[VoiceActivityDetector alloc] initWithSampleRate:[AVAudioSession sharedInstance].sampleRate];
+    }
+    
+    // The leading silence gate is only used with local end of speech detection, because the SDK's
+    // own detection needs the silence to notice that the user has not spoken. Its detector starts
+    // from the ambient noise estimate, since a search started by the hot phrase begins while the
+    // user is still speaking. Off by default (LEADING_SILENCE_GUARD_INTERVAL 0); 0.3 works well.
+    
+    if (self.localEndOfSpeechDetection && LEADING_SILENCE_GUARD_INTERVAL > 0) {
+        self.leadingSilenceGate = [[SpeechGate alloc] initWithSampleRate:[AVAudioSession sharedInstance].sampleRate
+                                                        lookBackDuration:LEADING_SILENCE_GUARD_INTERVAL];
+    }
+    
+    [self stopHotPhraseGate];
+    
     [self.query start];
     
 }
 
+- (void)cancelSearch
+{
+    // The SDK reports the cancellation asynchronously. If the query is still recording, for example
+    // when the app resigns active, stop feeding it right away instead: drop any audio held by the
+    // leading silence gate and stop listening for end of speech.
+    
+    self.leadingSilenceGate = nil;
+    self.endOfSpeechDetector = nil;
+    self.pendingPartialTranscript = nil;
+    
+    self.cancelTime = CACurrentMediaTime();
+    
+    [self.query cancel];
+}
+
+#pragma mark - Hot Phrase Gate
+
+- (void)startHotPhraseGate
+{
+    // Spotting the hot phrase in every buffer, even in a silent room, is the largest cost of
+    // leaving hot phrase detection on. A voice activity detector is much cheaper to run, so use
+    // it to decide which audio is worth passing on to the spotter.
+    
+    if (HOT_PHRASE_GUARD_INTERVAL <= 0 || ![HoundVoiceSearch instance].enableHotPhraseDetection || self.hotPhraseGate) {
+        return;
+    }
+    
+    SpeechGate *gate = [[SpeechGate alloc] initWithSampleRate:[AVAudioSession sharedInstance].sampleRate
+                                             lookBackDuration:HOT_PHRASE_GUARD_INTERVAL];
+    
+    gate.closesAfterSpeech = YES;
+    gate.detector.leadingSilenceDuration = 0;
+    
+    self.hotPhraseGate = gate;
+}
+
+- (void)updateHotPhraseGate
+{
+    // enableHotPhraseDetection can change at any time, for example from SettingsViewController.
+    // passAudioData: stops using the gate as soon as detection is switched off; this installs or
+    // removes the gate to match.
+    
+    if (![HoundVoiceSearch instance].enableHotPhraseDetection) {
+        [self stopHotPhraseGate];
+    } else if (self.setupState == RawVoiceSearchViewControllerSetupStateSetUp &&
+               (!self.query || self.query.state == HoundVoiceSearchQueryStateFinished)) {
+        [self startHotPhraseGate];
+    }
+}
+
+- (void)stopHotPhraseGate
+{
+    SpeechGate *gate = self.hotPhraseGate;
+    self.hotPhraseGate = nil;
+    
+    NSUInteger total = gate.passedByteCount + gate.discardedByteCount;
+    
+    if (total > 0) {
+        NSLog(@"Hot phrase spotter ran on %.0f%% of idle audio (%lu of %lu bytes)",
+              gate.passedByteCount * 100.0 / total, (unsigned long)gate.passedByteCount, (unsigned long)total);
+    }
+}
+
 # pragma mark - HoundVoiceSearchQueryDelegate
 
 - (void)houndVoiceSearchQuery:(HoundVoiceSearchQuery *)query changedStateFrom:(HoundVoiceSearchQueryState)oldState to:(HoundVoiceSearchQueryState)newState
 {
     [self refreshUI];
     
+    if (oldState == HoundVoiceSearchQueryStateRecording) {
+        // Drop any partial transcript still waiting to be displayed, and stop listening for end of speech.
+        self.pendingPartialTranscript = nil;
+        self.endOfSpeechDetector = nil;
+        
+        SpeechGate *gate = self.leadingSilenceGate;
+        self.leadingSilenceGate = nil;
+        
+        if (gate) {
+            NSLog(@"Uploaded %lu bytes, held back %lu bytes of leading silence",
+                  (unsigned long)gate.passedByteCount, (unsigned long)gate.discardedByteCount);
+        }
+    }
+    
     if (newState == HoundVoiceSearchQueryStateFinished) {
+        [self startHotPhraseGate];
+        
+        if (self.cancelTime > 0) {
+            NSLog(@"Canceled query finished after %.0f ms", (CACurrentMediaTime() - self.cancelTime) * 1000.0);
+            
+            self.cancelTime = 0;
+        }
+        
+        [self logPartialTranscriptDisplayTime];
+        
+        AudioConditioner *conditioner = self.audioConditioner;
+        
+        if (conditioner.processedBufferCount > 0) {
+            NSLog(@"Audio conditioning: %.1f us per buffer over %lu buffers",
+                  conditioner.processingTime * 1000000.0 / conditioner.processedBufferCount,
+                  (unsigned long)conditioner.processedBufferCount);
+        }
+        
         [self refreshTextView];
     }
 }
@@ -247,7 +539,19 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
     // updates which can be displayed to the user.
     
     if (query == self.query) {
-        self.updateText = partialTranscript.partialTranscript;
+        [self displayPartialTranscript:partialTranscript];
+        
+        // When safeToStopAudio is set, the server already has all the audio it needs for this
+        // query. Rather than continuing to stream until end of speech is detected locally, the
+        // application may move the query on to Searching right away.
+        
+        if (STOP_RECORDING_WHEN_SAFE && partialTranscript.safeToStopAudio &&
+            (query.automaticEndOfSpeech || self.localEndOfSpeechDetection) &&
+            query.state == HoundVoiceSearchQueryStateRecording) {
+            NSLog(@"Server has enough audio after %lu ms, finishing recording", (unsigned long)partialTranscript.durationMS);
+            
+            [query finishRecording];
+        }
     }
 }
 
@@ -271,7 +575,12 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
     if (specialExampleText) {
         self.responseText = specialExampleText;
     } else {
-        self.responseText = [JSONAttributedFormatter attributedStringFromObject:dictionary style:nil];
+        // Format the response off the main thread, and drop it if a new search has started since.
+        [JSONAttributedFormatter attributedStringFromObject:dictionary style:nil queue:dispatch_get_main_queue() completion:^(NSAttributedString *attributedString) {
+            if (self.query == query) {
+                self.responseText = attributedString;
+            }
+        }];
     }
     
     if (commandResult[@"NativeData"]) {
@@ -303,6 +612,63 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
     self.updateText = @"Canceled";
 }
 
+#pragma mark - Partial Transcripts
+
+- (void)displayPartialTranscript:(HoundDataPartialTranscript *)partialTranscript
+{
+    // On a fast connection partial transcripts can arrive faster than they can usefully be
+    // drawn. Display at most one every PARTIAL_TRANSCRIPT_INTERVAL seconds, always the newest,
+    // and display the final one (done == YES) immediately.
+    
+    BOOL displayScheduled = self.pendingPartialTranscript != nil;
+    
+    self.pendingPartialTranscript = partialTranscript;
+    self.partialTranscriptsReceived++;
+    
+    CFTimeInterval elapsed = CACurrentMediaTime() - self.lastPartialTranscriptTime;
+    
+    if (partialTranscript.done || elapsed >= PARTIAL_TRANSCRIPT_INTERVAL) {
+        [self flushPartialTranscript];
+    } else if (!displayScheduled) {
+        __weak typeof(self) weakSelf = self;
+        
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)((PARTIAL_TRANSCRIPT_INTERVAL - elapsed) * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            [weakSelf flushPartialTranscript];
+        });
+    }
+}
+
+- (void)flushPartialTranscript
+{
+    if (!self.pendingPartialTranscript) {
+        return;
+    }
+    
+    CFTimeInterval start = CACurrentMediaTime();
+    
+    self.updateText = self.pendingPartialTranscript.partialTranscript;
+    
+    self.pendingPartialTranscript = nil;
+    self.lastPartialTranscriptTime = CACurrentMediaTime();
+    self.partialTranscriptsDisplayed++;
+    self.partialTranscriptDisplayTime += self.lastPartialTranscriptTime - start;
+}
+
+- (void)logPartialTranscriptDisplayTime
+{
+    if (self.partialTranscriptsDisplayed == 0) {
+        return;
+    }
+    
+    // Without the rate limit every partial transcript received would have been displayed, at
+    // about the same cost each.
+    CFTimeInterval unlimitedTime = self.partialTranscriptDisplayTime / self.partialTranscriptsDisplayed * self.partialTranscriptsReceived;
+    
+    NSLog(@"Displayed %lu of %lu partial transcripts in %.1f ms on the main thread (about %.1f ms without rate limiting)",
+          (unsigned long)self.partialTranscriptsDisplayed, (unsigned long)self.partialTranscriptsReceived,
+          self.partialTranscriptDisplayTime * 1000.0, unlimitedTime * 1000.0);
+}
+
 #pragma mark - Client Integration Example
 
 - (void)tryUpdateQueryResponse:(HoundVoiceSearchQuery *)query
@@ -366,7 +732,7 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
 
 - (void)applicationWillResignActive:(NSNotification*)notification
 {
-    [self.query cancel];
+    [self cancelSearch];
 }
 
 #pragma mark - IBActions
@@ -398,11 +764,11 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
             [self startSearch];
             break;
         case HoundVoiceSearchQueryStateRecording:
-            [self.query finishRecording];
+            [self finishRecording];
             [self resetTextView];
             break;
         case HoundVoiceSearchQueryStateSearching:
-            [self.query cancel];
+            [self cancelSearch];
             [self resetTextView];
             break;
         case HoundVoiceSearchQueryStateSpeaking:
@@ -434,9 +800,13 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
 - (void)setUpdateText:(NSString *)updateText
 {
     if (![_updateText isEqual:updateText]) {
+        NSString *previousText = _updateText;
+        
         _updateText = [updateText copy];
         
-        [self refreshTextView];
+        if (![self patchTextViewFromText:previousText]) {
+            [self refreshTextView];
+        }
     }
 }
 
@@ -475,6 +845,34 @@ typedef NS_ENUM(NSUInteger, RawVoiceSearchViewControllerSetupState) {
     }
 }
 
+- (BOOL)patchTextViewFromText:(NSString *)previousText
+{
+    // Successive partial transcripts usually differ only at the end. If the text view is
+    // showing the previous transcript, replace just the part after the common prefix rather
+    // than resetting the whole text and laying it out again.
+    
+    if (self.responseText.length > 0 || previousText.length == 0 || self.updateText.length == 0) {
+        return NO;
+    }
+    
+    if (![self.textView.text isEqualToString:previousText]) {
+        return NO;
+    }
+    
+    NSUInteger stableLength = [previousText commonPrefixWithString:self.updateText options:NSLiteralSearch].length;
+    
+    if (stableLength == 0) {
+        return NO;
+    }
+    
+    NSRange changedRange = NSMakeRange(stableLength, previousText.length - stableLength);
+    
+    [self.textView.textStorage replaceCharactersInRange:changedRange
+                                             withString:[self.updateText substringFromIndex:stableLength]];
+    
+    return YES;
+}
+
 - (void)updateStatus:(NSString *)status
 {
     self.statusLabel.text = status;
@@ -0,0 +1,53 @@
+//
+//  SpeechGate.h
+//  HoundifySDK Sample App (Objective-C)
+//
+//  Created by SoundHound on 10/19/26.
+//  Copyright (c) 2026 SoundHound, Inc. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "VoiceActivityDetector.h"
+
+#pragma mark - SpeechGate
+
+/**
+ Holds back 16 bit linear PCM audio until speech is detected.
+
+ While the gate is closed, audio is kept in a short look-back buffer and older audio is
+ discarded. When the voice activity detector reports SpeechStarted, the gate opens and returns the
+ look-back buffer along with the current audio, so the onset of speech is never lost.
+ Once open, the gate passes all audio through, unless closesAfterSpeech is set.
+
+ Like VoiceActivityDetector, an instance must only be used from one thread at a time.
+ */
+@interface SpeechGate : NSObject
+
+- (instancetype)initWithSampleRate:(double)sampleRate lookBackDuration:(NSTimeInterval)lookBackDuration;
+
+/** The detector used to open the gate. Its settings may be adjusted before use. */
+@property (nonatomic, readonly) VoiceActivityDetector *detector;
+
+@property (nonatomic, readonly) BOOL isOpen;
+
+/** If YES, the gate closes again once the detector no longer hears speech. Default NO. */
+@property (nonatomic, assign) BOOL closesAfterSpeech;
+
+/** Bytes of audio discarded while the gate was closed. */
+@property (nonatomic, readonly) NSUInteger discardedByteCount;
+
+/** Bytes of audio passed through the gate, including look-back audio. */
+@property (nonatomic, readonly) NSUInteger passedByteCount;
+
+/**
+ Returns the audio to pass on, in order, or nil if the audio is being held back.
+ */
+- (NSArray<NSData *> *)processAudioData:(NSData *)data;
+
+/**
+ Opens the gate without waiting for speech, and returns the look-back audio to pass on first.
+ Use this before the audio stops, so that the audio held back is not lost.
+ */
+- (NSArray<NSData *> *)open;
+
+@end
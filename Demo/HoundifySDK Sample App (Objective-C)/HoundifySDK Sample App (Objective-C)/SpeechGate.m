@@ -0,0 +1,94 @@
+//
+//  SpeechGate.m
+//  HoundifySDK Sample App (Objective-C)
+//
+//  Created by SoundHound on 10/19/26.
+//  Copyright (c) 2026 SoundHound, Inc. All rights reserved.
+//
+
+#import "SpeechGate.h"
+
+#pragma mark - SpeechGate
+
+@interface SpeechGate()
+
+@property(nonatomic, strong, readwrite) VoiceActivityDetector* detector;
+
+@property(nonatomic, strong) NSMutableArray<NSData*>* lookBack;
+@property(nonatomic, assign) NSUInteger lookBackByteCount;
+@property(nonatomic, assign) NSUInteger lookBackCapacity;
+
+@property(nonatomic, assign, readwrite) BOOL isOpen;
+@property(nonatomic, assign, readwrite) NSUInteger discardedByteCount;
+@property(nonatomic, assign, readwrite) NSUInteger passedByteCount;
+
+@end
+
+@implementation SpeechGate
+
+- (instancetype)initWithSampleRate:(double)sampleRate lookBackDuration:(NSTimeInterval)lookBackDuration
+{
+    self = [super init];
+
+    if (self)
+    {
+        self.detector = [[VoiceActivityDetector alloc] initWithSampleRate:sampleRate];
+        self.lookBack = [NSMutableArray array];
+        self.lookBackCapacity = (NSUInteger)(lookBackDuration * sampleRate) * sizeof(SInt16);
+    }
+
+    return self;
+}
+
+- (NSArray<NSData*>*)processAudioData:(NSData*)data
+{
+    VoiceActivityDetectorEvent event = [self.detector processAudioData:data];
+
+    if (self.isOpen)
+    {
+        self.passedByteCount += data.length;
+
+        if (self.closesAfterSpeech && !self.detector.voiceActive && !self.detector.inSpeech)
+        {
+            self.isOpen = NO;
+        }
+
+        return @[data];
+    }
+
+    [self.lookBack addObject:data];
+    self.lookBackByteCount += data.length;
+
+    // Open on SpeechStarted rather than voiceActive, so that a single click does not open the gate
+    if (event != VoiceActivityDetectorEventSpeechStarted)
+    {
+        // Keep only as much audio as the look-back needs
+        while (self.lookBack.count > 1 &&
+            self.lookBackByteCount - self.lookBack.firstObject.length >= self.lookBackCapacity)
+        {
+            self.lookBackByteCount -= self.lookBack.firstObject.length;
+            self.discardedByteCount += self.lookBack.firstObject.length;
+
+            [self.lookBack removeObjectAtIndex:0];
+        }
+
+        return nil;
+    }
+
+    return [self open];
+}
+
+- (NSArray<NSData*>*)open
+{
+    NSArray<NSData*>* audio = [self.lookBack copy];
+
+    self.isOpen = YES;
+    self.passedByteCount += self.lookBackByteCount;
+
+    [self.lookBack removeAllObjects];
+    self.lookBackByteCount = 0;
+
+    return audio;
+}
+
+@end
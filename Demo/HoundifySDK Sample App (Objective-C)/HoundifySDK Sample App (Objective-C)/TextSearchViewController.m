@@ -20,6 +20,12 @@
 
 @property(nonatomic, strong) HoundTextSearchQuery *query;
 
+// The query whose response is being displayed. Formatting finishes asynchronously, so results for
+// any other query are dropped.
+@property(nonatomic, strong) HoundTextSearchQuery *displayedQuery;
+
+@property(nonatomic, assign) CFTimeInterval cancelTime;
+
 @end
 
 @implementation TextSearchViewController
@@ -33,7 +39,8 @@
 {
     self.searchBar.text = [NSString stringWithFormat:@"Searching: %@", searchText];
     
-    [self.query cancel];
+    // Replace any search still running. Its callbacks are ignored from here on.
+    [self cancelSearch];
     
     self.query = [[HoundTextSearch instance] newTextSearchWithSearchText:searchText];
     
@@ -55,8 +62,14 @@
 
 - (void)houndTextSearchQuery:(HoundTextSearchQuery * _Nonnull)query didReceiveSearchResult:(HoundDataHoundServer * _Nonnull)houndServer dictionary:(NSDictionary * _Nonnull)dictionary
 {
+    if (query != self.query) {
+        return;
+    }
+    
     [self.searchBar resignFirstResponder];
     
+    self.displayedQuery = query;
+    
     // Domains that work with client features often return incomplete results that need
     // to be completed by the application before they are ready to use. See this method for
     // an example
@@ -71,9 +84,15 @@
     if (specialExampleText) {
         self.textView.attributedText = specialExampleText;
     } else {
-        self.textView.attributedText = [JSONAttributedFormatter
-                                        attributedStringFromObject:dictionary
-                                        style:nil];
+        // Format the response off the main thread, and drop it if a new search has started since.
+        [JSONAttributedFormatter attributedStringFromObject:dictionary
+                                                      style:nil
+                                                      queue:dispatch_get_main_queue()
+                                                 completion:^(NSAttributedString *attributedString) {
+                                                     if (query == self.displayedQuery) {
+                                                         self.textView.attributedText = attributedString;
+                                                     }
+                                                 }];
     }
     
     self.searchBar.showsCancelButton = NO;
@@ -83,8 +102,13 @@
 
 - (void)houndTextSearchQuery:(HoundTextSearchQuery * _Nonnull)query didFailWithError:(NSError * _Nonnull)error
 {
+    if (query != self.query) {
+        return;
+    }
+    
     [self.searchBar resignFirstResponder];
     
+    self.displayedQuery = nil;
     self.textView.text = [NSString stringWithFormat:@"%@ (%d)\n%@",
                           error.domain,
                           (int)error.code,
@@ -98,6 +122,18 @@
 
 - (void)houndTextSearchQueryDidCancel:(HoundTextSearchQuery * _Nonnull)query
 {
+    if (self.cancelTime > 0) {
+        NSLog(@"Canceled query finished after %.0f ms", (CACurrentMediaTime() - self.cancelTime) * 1000.0);
+        
+        self.cancelTime = 0;
+    }
+    
+    // A search replaced by a new one is canceled too. Leave the display to the new search.
+    if (query != self.query) {
+        return;
+    }
+    
+    self.displayedQuery = nil;
     self.textView.text = @"Canceled";
     
     self.searchBar.showsCancelButton = NO;
@@ -105,6 +141,18 @@
     self.query = nil;
 }
 
+- (void)cancelSearch
+{
+    // The SDK reports the cancellation asynchronously. Stop displaying anything for this search
+    // in the meantime.
+    
+    self.displayedQuery = nil;
+    
+    self.cancelTime = self.query ? CACurrentMediaTime() : 0;
+    
+    [self.query cancel];
+}
+
 #pragma mark - Client Integration Example
 
 - (void)tryUpdateQueryResponse:(HoundTextSearchQuery *)query
@@ -178,7 +226,7 @@
 {
     [searchBar resignFirstResponder];
     
-    [self.query cancel];
+    [self cancelSearch];
 }
 
 - (void)searchBarTextDidBeginEditing:(UISearchBar *)searchBar
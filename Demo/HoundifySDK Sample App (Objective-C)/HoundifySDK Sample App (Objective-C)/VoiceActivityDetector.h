@@ -0,0 +1,82 @@
+//
+//  VoiceActivityDetector.h
+//  HoundifySDK Sample App (Objective-C)
+//
+//  Created by SoundHound on 10/19/26.
+//  Copyright (c) 2026 SoundHound, Inc. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#pragma mark - Events
+
+typedef NS_ENUM(NSUInteger, VoiceActivityDetectorEvent)
+{
+    VoiceActivityDetectorEventNone,
+    VoiceActivityDetectorEventSpeechStarted,
+    VoiceActivityDetectorEventSpeechEnded,
+    VoiceActivityDetectorEventNoSpeech
+};
+
+#pragma mark - VoiceActivityDetector
+
+/**
+ An energy based voice activity detector for 16 bit linear PCM audio, as delivered by AudioTester.
+
+ Each buffer passed to -processAudioData: is compared against a running estimate of the
+ background noise level. The timing properties control how quickly the start and end of
+ speech are reported, so end-of-speech detection can be tuned for the application.
+
+ An instance keeps state between buffers and must only be used from one thread at a time.
+ */
+@interface VoiceActivityDetector : NSObject
+
+- (instancetype)initWithSampleRate:(double)sampleRate;
+
+/** How far above the background noise, in dB, a buffer must be to count as speech. Default 12. */
+@property (nonatomic, assign) float speechMargin;
+
+/** Buffers quieter than this level, in dBFS, never count as speech. Default -50. */
+@property (nonatomic, assign) float minimumSpeechLevel;
+
+/** How long speech must last before SpeechStarted is reported. Default 0.1 seconds. */
+@property (nonatomic, assign) NSTimeInterval minimumSpeechDuration;
+
+/** How long voiceActive stays true after the level drops, bridging short gaps between words. Default 0.2 seconds. */
+@property (nonatomic, assign) NSTimeInterval hangoverDuration;
+
+/** How long voiceActive must stay false after speech before SpeechEnded is reported. Default 0.5 seconds. */
+@property (nonatomic, assign) NSTimeInterval trailingSilenceDuration;
+
+/** If no speech starts within this time, NoSpeech is reported once. 0 waits indefinitely. Default 5 seconds. */
+@property (nonatomic, assign) NSTimeInterval leadingSilenceDuration;
+
+/** If speech lasts this long, SpeechEnded is reported anyway. 0 waits indefinitely. Default 15 seconds. */
+@property (nonatomic, assign) NSTimeInterval maximumSpeechDuration;
+
+/** True if the most recent buffer, including hangover, was classified as speech. */
+@property (nonatomic, readonly) BOOL voiceActive;
+
+/** True between SpeechStarted and SpeechEnded. */
+@property (nonatomic, readonly) BOOL inSpeech;
+
+/** Total duration of audio processed since the last reset. */
+@property (nonatomic, readonly) NSTimeInterval processedDuration;
+
+/** The background noise estimate, in dBFS. Only valid once hasNoiseLevel is YES. */
+@property (nonatomic, readonly) BOOL hasNoiseLevel;
+@property (nonatomic, readonly) float noiseLevel;
+
+/**
+ Starts the background noise estimate at noiseLevel instead of at the level of the first buffer.
+ A detector created while the user may already be speaking should be seeded from one that has
+ been listening for longer, or it would measure speech against speech.
+ */
+- (void)seedNoiseLevel:(float)noiseLevel;
+
+- (VoiceActivityDetectorEvent)processAudioData:(NSData *)data;
+
+/** Clears all state, including the background noise estimate. */
+- (void)reset;
+
+@end
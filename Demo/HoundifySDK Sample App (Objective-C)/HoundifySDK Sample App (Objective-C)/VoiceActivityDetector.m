@@ -0,0 +1,202 @@
+//
+//  VoiceActivityDetector.m
+//  HoundifySDK Sample App (Objective-C)
+//
+//  Created by SoundHound on 10/19/26.
+//  Copyright (c) 2026 SoundHound, Inc. All rights reserved.
+//
+
+#import "VoiceActivityDetector.h"
+
+@import Accelerate;
+
+// Time constants for the background noise estimate to rise towards the current level, in quiet
+// audio and in audio classified as speech. Rising slowly during speech lets the estimate catch
+// up with a sudden, lasting increase in background noise.
+#define NOISE_TIME_CONSTANT                     2.0
+#define LOUD_NOISE_TIME_CONSTANT                10.0
+
+#pragma mark - VoiceActivityDetector
+
+@interface VoiceActivityDetector()
+
+@property(nonatomic, assign) double sampleRate;
+
+@property(nonatomic, assign) float* samples;
+@property(nonatomic, assign) vDSP_Length sampleCapacity;
+
+@property(nonatomic, assign, readwrite) BOOL hasNoiseLevel;
+@property(nonatomic, assign, readwrite) float noiseLevel;
+
+@property(nonatomic, assign) NSTimeInterval loudDuration;
+@property(nonatomic, assign) NSTimeInterval quietDuration;
+@property(nonatomic, assign) NSTimeInterval speechDuration;
+@property(nonatomic, assign) BOOL heardSpeech;
+@property(nonatomic, assign) BOOL reportedNoSpeech;
+
+@property(nonatomic, assign, readwrite) BOOL voiceActive;
+@property(nonatomic, assign, readwrite) BOOL inSpeech;
+@property(nonatomic, assign, readwrite) NSTimeInterval processedDuration;
+
+@end
+
+@implementation VoiceActivityDetector
+
+- (instancetype)initWithSampleRate:(double)sampleRate
+{
+    self = [super init];
+
+    if (self)
+    {
+        self.sampleRate = sampleRate;
+
+        self.speechMargin = 12.0;
+        self.minimumSpeechLevel = -50.0;
+        self.minimumSpeechDuration = 0.1;
+        self.hangoverDuration = 0.2;
+        self.trailingSilenceDuration = 0.5;
+        self.leadingSilenceDuration = 5.0;
+        self.maximumSpeechDuration = 15.0;
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    free(self.samples);
+}
+
+- (void)reset
+{
+    self.hasNoiseLevel = NO;
+    self.loudDuration = 0;
+    self.quietDuration = 0;
+    self.speechDuration = 0;
+    self.heardSpeech = NO;
+    self.reportedNoSpeech = NO;
+    self.voiceActive = NO;
+    self.inSpeech = NO;
+    self.processedDuration = 0;
+}
+
+- (void)seedNoiseLevel:(float)noiseLevel
+{
+    self.noiseLevel = noiseLevel;
+    self.hasNoiseLevel = YES;
+}
+
+- (VoiceActivityDetectorEvent)processAudioData:(NSData *)data
+{
+    vDSP_Length count = data.length / sizeof(SInt16);
+
+    if (count == 0)
+    {
+        return VoiceActivityDetectorEventNone;
+    }
+
+    NSTimeInterval duration = count / self.sampleRate;
+    float level = [self levelOfSamples:data.bytes count:count];
+
+    self.processedDuration += duration;
+
+    if (!self.hasNoiseLevel)
+    {
+        self.noiseLevel = level;
+        self.hasNoiseLevel = YES;
+    }
+
+    BOOL loud = level > self.minimumSpeechLevel && level > self.noiseLevel + self.speechMargin;
+
+    if (loud)
+    {
+        self.loudDuration += duration;
+        self.quietDuration = 0;
+        self.voiceActive = YES;
+
+        self.noiseLevel += (level - self.noiseLevel) * MIN(duration / LOUD_NOISE_TIME_CONSTANT, 1.0);
+    }
+    else
+    {
+        self.loudDuration = 0;
+        self.quietDuration += duration;
+
+        if (self.quietDuration >= self.hangoverDuration)
+        {
+            self.voiceActive = NO;
+        }
+
+        // Follow the background noise down immediately, and up slowly
+        if (level < self.noiseLevel)
+        {
+            self.noiseLevel = level;
+        }
+        else
+        {
+            self.noiseLevel += (level - self.noiseLevel) * MIN(duration / NOISE_TIME_CONSTANT, 1.0);
+        }
+    }
+
+    if (!self.inSpeech)
+    {
+        if (self.loudDuration >= self.minimumSpeechDuration)
+        {
+            self.inSpeech = YES;
+            self.heardSpeech = YES;
+            self.speechDuration = 0;
+
+            return VoiceActivityDetectorEventSpeechStarted;
+        }
+
+        if (!self.heardSpeech && !self.reportedNoSpeech && self.leadingSilenceDuration > 0 &&
+            self.processedDuration >= self.leadingSilenceDuration)
+        {
+            self.reportedNoSpeech = YES;
+
+            return VoiceActivityDetectorEventNoSpeech;
+        }
+    }
+    else
+    {
+        self.speechDuration += duration;
+
+        if (!self.voiceActive && self.quietDuration >= self.hangoverDuration + self.trailingSilenceDuration)
+        {
+            self.inSpeech = NO;
+
+            return VoiceActivityDetectorEventSpeechEnded;
+        }
+
+        if (self.maximumSpeechDuration > 0 && self.speechDuration >= self.maximumSpeechDuration)
+        {
+            // Require a fresh onset before speech is reported again
+            self.inSpeech = NO;
+            self.loudDuration = 0;
+
+            return VoiceActivityDetectorEventSpeechEnded;
+        }
+    }
+
+    return VoiceActivityDetectorEventNone;
+}
+
+#pragma mark - Utility
+
+- (float)levelOfSamples:(const SInt16*)samples count:(vDSP_Length)count
+{
+    if (count > self.sampleCapacity)
+    {
+        self.samples = realloc(self.samples, count * sizeof(float));
+        self.sampleCapacity = count;
+    }
+
+    float rms = 0;
+
+    vDSP_vflt16(samples, 1, self.samples, 1, count);
+    vDSP_rmsqv(self.samples, 1, &rms, count);
+
+    // RMS level in dBFS, floored at -120
+    return 20.0f * log10f(MAX(rms / 32768.0f, 1e-6f));
+}
+
+@end
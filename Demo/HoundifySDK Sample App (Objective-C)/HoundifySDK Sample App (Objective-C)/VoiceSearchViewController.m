@@ -13,6 +13,12 @@
 @import HoundifySDK;
 @import AVFoundation;
 
+#define PARTIAL_TRANSCRIPT_INTERVAL             0.1
+#define STOP_RECORDING_WHEN_SAFE                0
+#define SPECULATIVE_SEARCH_INTERVAL             0
+#define SPECULATIVE_SPEECH_POLL_INTERVAL        0.25
+#define PIPELINE_AUTO_LISTEN                    0
+
 #pragma mark - VoiceSearchViewController
 
 @interface VoiceSearchViewController() <HoundVoiceSearchQueryDelegate>
@@ -25,6 +31,27 @@
 @property(nonatomic, strong) UIView* levelView;
 
 @property(nonatomic, strong) HoundVoiceSearchQuery *query;
+@property(nonatomic, strong) HoundVoiceSearchQuery *nextQuery;
+
+@property (nonatomic, strong) HoundDataPartialTranscript *pendingPartialTranscript;
+@property (nonatomic, assign) CFTimeInterval lastPartialTranscriptTime;
+@property (nonatomic, assign) NSUInteger partialTranscriptsReceived;
+@property (nonatomic, assign) NSUInteger partialTranscriptsDisplayed;
+@property (nonatomic, assign) CFTimeInterval partialTranscriptDisplayTime;
+
+@property (nonatomic, strong) HoundTextSearchQuery *speculativeQuery;
+@property (nonatomic, copy) NSString *stablePartialText;
+@property (nonatomic, assign) NSUInteger stablePartialGeneration;
+@property (nonatomic, copy) NSString *finalTranscript;
+@property (nonatomic, assign) CFTimeInterval finalTranscriptTime;
+@property (nonatomic, assign) BOOL usedSpeculativeResult;
+@property (nonatomic, assign) BOOL speculativeSpeechStarted;
+@property (nonatomic, assign) NSUInteger speculativeSearchesStarted;
+@property (nonatomic, assign) NSUInteger speculativeSearchesUsed;
+
+@property (nonatomic, readonly) BOOL speakingSpeculativeResult;
+
+@property (nonatomic, assign) CFTimeInterval cancelTime;
 
 @property (nonatomic, readonly) NSString *explanatoryText;
 @property (nonatomic, copy) NSString *updateText;
@@ -104,7 +131,7 @@
 - (void)refreshUI
 {
     // Search button
-    if (self.query && self.query.state != HoundVoiceSearchQueryStateFinished) {
+    if ((self.query && self.query.state != HoundVoiceSearchQueryStateFinished) || self.speakingSpeculativeResult) {
         [self.searchButton setTitle:@"Stop" forState:UIControlStateNormal];
         self.searchButton.enabled = YES;
     } else {
@@ -114,7 +141,7 @@
     
     if (![HoundVoiceSearch instance].isListening) {
         self.searchButton.backgroundColor = [self.view.tintColor colorWithAlphaComponent:0.5];
-    } else if (self.query.state == HoundVoiceSearchQueryStateSpeaking) {
+    } else if (self.query.state == HoundVoiceSearchQueryStateSpeaking || self.speakingSpeculativeResult) {
         self.searchButton.backgroundColor = [UIColor redColor];
     } else {
         self.searchButton.backgroundColor = self.view.tintColor;
@@ -128,6 +155,8 @@
     
     if (![HoundVoiceSearch instance].isListening) {
         status = @"Not Ready";
+    } else if (self.speakingSpeculativeResult) {
+        status = @"Speaking";
     } else if (self.query) {
         switch (self.query.state) {
             case HoundVoiceSearchQueryStateRecording:
@@ -197,21 +226,51 @@
     // Configure it, including setting its delegate
     // And call -start
     
-    self.query = [[HoundVoiceSearch instance] newVoiceSearch];
+    self.nextQuery = nil;
     
-    self.query.delegate = self;
+    [self startQuery:[self prepareQuery]];
+}
+
+- (HoundVoiceSearchQuery *)prepareQuery
+{
+    HoundVoiceSearchQuery *query = [[HoundVoiceSearch instance] newVoiceSearch];
     
-    // An example of how to use RequestInfo: set the location to SoundHound HQ.
-    // a real application, of course, one would use location services to determine
-    // the device's location.
+    query.delegate = self;
     
-    self.query.requestInfoBuilder.latitude = 37.4089054;
-    self.query.requestInfoBuilder.longitude = -121.9849621;
-    self.query.requestInfoBuilder.positionTime = lround([[NSDate date] timeIntervalSince1970]);
-    self.query.requestInfoBuilder.positionHorizontalAccuracy = 10.0;
+    [self configureRequestInfoBuilder:query.requestInfoBuilder];
+    
+    return query;
+}
+
+- (void)startQuery:(HoundVoiceSearchQuery *)query
+{
+    self.query = query;
+    
+    self.partialTranscriptsReceived = 0;
+    self.partialTranscriptsDisplayed = 0;
+    self.partialTranscriptDisplayTime = 0;
+    self.cancelTime = 0;
+    
+    [self cancelSpeculativeSearch];
+    
+    self.stablePartialText = nil;
+    self.stablePartialGeneration++;
+    self.finalTranscript = nil;
+    self.usedSpeculativeResult = NO;
     
     [self.query start];
+}
 
+- (void)configureRequestInfoBuilder:(HoundRequestInfoBuilder *)requestInfoBuilder
+{
+    // An example of how to use RequestInfo: set the location to SoundHound HQ.
+    // a real application, of course, one would use location services to determine
+    // the device's location.
+    
+    requestInfoBuilder.latitude = 37.4089054;
+    requestInfoBuilder.longitude = -121.9849621;
+    requestInfoBuilder.positionTime = lround([[NSDate date] timeIntervalSince1970]);
+    requestInfoBuilder.positionHorizontalAccuracy = 10.0;
 }
 
 # pragma mark - HoundVoiceSearchQueryDelegate
@@ -220,8 +279,27 @@
 {
     [self refreshUI];
     
+    if (oldState == HoundVoiceSearchQueryStateRecording) {
+        // Drop any partial transcript still waiting to be displayed.
+        self.pendingPartialTranscript = nil;
+    }
+    
     if (newState == HoundVoiceSearchQueryStateFinished) {
+        if (query == self.query && self.cancelTime > 0) {
+            NSLog(@"Canceled query finished after %.0f ms", (CACurrentMediaTime() - self.cancelTime) * 1000.0);
+            
+            self.cancelTime = 0;
+        }
+        
+        [self logPartialTranscriptDisplayTime];
+        
         [self refreshTextView];
+        
+        // A voice query canceled for a speculative result finishes while that result is still
+        // speaking; the follow-up starts from watchSpeculativeSpeech instead.
+        if (query == self.query && !self.speakingSpeculativeResult) {
+            [self startNextQuery];
+        }
     }
 }
 
@@ -231,7 +309,19 @@
     // updates which can be displayed to the user.
 
     if (query == self.query) {
-        self.updateText = partialTranscript.partialTranscript;
+        [self displayPartialTranscript:partialTranscript];
+        [self speculateWithPartialTranscript:partialTranscript];
+        
+        // When safeToStopAudio is set, the server already has all the audio it needs for this
+        // query. Rather than continuing to stream until end of speech is detected locally, the
+        // application may move the query on to Searching right away.
+        
+        if (STOP_RECORDING_WHEN_SAFE && partialTranscript.safeToStopAudio && query.automaticEndOfSpeech &&
+            query.state == HoundVoiceSearchQueryStateRecording) {
+            NSLog(@"Server has enough audio after %lu ms, finishing recording", (unsigned long)partialTranscript.durationMS);
+            
+            [query finishRecording];
+        }
     }
 }
 
@@ -241,11 +331,30 @@
         return;
     }
     
+    // The voice query answered first, so a speculative text search is no longer needed.
+    [self cancelSpeculativeSearch];
+    
     // Domains that work with client features often return incomplete results that need
     // to be completed by the application before they are ready to use. See this method for
     // an example
-    [self tryUpdateQueryResponse:query];
+    [self tryUpdateQueryResponse:houndServer];
+    
+    [self displaySearchResult:houndServer dictionary:dictionary];
+    
+    // It is the application's responsibility to initiate text-to-speech for the response
+    // if it is desired.
+    // The SDK provides the -speakResponse method on HoundVoiceSearchQuery, or the
+    // the application may use its own TTS support.
+    [query speakResponse];
+}
 
+- (void)displaySearchResult:(HoundDataHoundServer *)houndServer dictionary:(NSDictionary *)dictionary
+{
+    if (self.finalTranscript) {
+        NSLog(@"Result displayed %.0f ms after final transcript%@", (CACurrentMediaTime() - self.finalTranscriptTime) * 1000.0,
+              self.usedSpeculativeResult ? @" (speculative text search)" : @"");
+    }
+    
     HoundDataCommandResult *commandResult = houndServer.allResults.firstObject;
     
     // This sample app includes more detailed examples of how to use a CommandResult
@@ -255,18 +364,24 @@
     if (specialExampleText) {
         self.responseText = specialExampleText;
     } else {
-        self.responseText = [JSONAttributedFormatter attributedStringFromObject:dictionary style:nil];
+        // Format the response off the main thread, and drop it if a new search has started since.
+        HoundVoiceSearchQuery *query = self.query;
+        
+        [JSONAttributedFormatter attributedStringFromObject:dictionary style:nil queue:dispatch_get_main_queue() completion:^(NSAttributedString *attributedString) {
+            if (self.query == query) {
+                self.responseText = attributedString;
+            }
+        }];
     }
     
     if (commandResult[@"NativeData"]) {
         NSLog(@"NativeData: %@", commandResult[@"NativeData"]);
     }
     
-    // It is the application's responsibility to initiate text-to-speech for the response
-    // if it is desired.
-    // The SDK provides the -speakResponse method on HoundVoiceSearchQuery, or the
-    // the application may use its own TTS support.
-    [query speakResponse];
+    // Both voice and speculative text search results can ask for a follow-up.
+    if (PIPELINE_AUTO_LISTEN && commandResult.autoListen) {
+        [self prepareNextQuery];
+    }
 }
 
 - (void)houndVoiceSearchQuery:(HoundVoiceSearchQuery *)query didFailWithError:(NSError *)error
@@ -274,22 +389,287 @@
     if (query != self.query) {
         return;
     }
+    
+    [self cancelSpeculativeSearch];
+    
+    self.nextQuery = nil;
 
     self.updateText = [NSString stringWithFormat:@"%@ %ld %@", error.domain, (long)error.code, error.localizedDescription];
 }
 
 - (void)houndVoiceSearchQueryDidCancel:(HoundVoiceSearchQuery *)query
 {
-    if (query != self.query) {
+    // A voice query cancelled in favor of a speculative text search result is not shown as canceled.
+    if (query != self.query || self.usedSpeculativeResult) {
         return;
     }
     
+    [self cancelSpeculativeSearch];
+    
+    self.nextQuery = nil;
+    
     self.updateText = @"Canceled";
 }
 
+- (void)cancelSearch
+{
+    // The SDK reports the cancellation asynchronously. Drop everything that would still act on
+    // this search in the meantime: the speculative text search, the follow-up query and any
+    // partial transcript waiting to be displayed.
+    
+    [self cancelSpeculativeSearch];
+    
+    self.nextQuery = nil;
+    self.pendingPartialTranscript = nil;
+    
+    self.cancelTime = CACurrentMediaTime();
+    
+    [self.query cancel];
+}
+
+#pragma mark - Follow-up Queries
+
+- (void)prepareNextQuery
+{
+    // When a result sets autoListen, the server expects the user to answer, and the application
+    // should start listening again once the response has been spoken. Build the follow-up query
+    // now, while the response is speaking, so that all that is left to do then is start it.
+    // The SDK carries the conversation state over, as it does for any other query.
+    // This is off by default (PIPELINE_AUTO_LISTEN).
+    
+    self.nextQuery = [self prepareQuery];
+}
+
+- (void)startNextQuery
+{
+    // Keep the follow-up until it can start. If the previous query is still finishing, this
+    // is called again when it reaches Finished.
+    
+    HoundVoiceSearchQuery *nextQuery = self.nextQuery;
+    
+    if (!nextQuery || self.query.isActive || ![HoundVoiceSearch instance].isListening) {
+        return;
+    }
+    
+    self.nextQuery = nil;
+    
+    NSLog(@"Starting follow-up query");
+    
+    [self blankTextView];
+    [self startQuery:nextQuery];
+}
+
+#pragma mark - Partial Transcripts
+
+- (void)displayPartialTranscript:(HoundDataPartialTranscript *)partialTranscript
+{
+    // On a fast connection partial transcripts can arrive faster than they can usefully be
+    // drawn. Display at most one every PARTIAL_TRANSCRIPT_INTERVAL seconds, always the newest,
+    // and display the final one (done == YES) immediately.
+    
+    BOOL displayScheduled = self.pendingPartialTranscript != nil;
+    
+    self.pendingPartialTranscript = partialTranscript;
+    self.partialTranscriptsReceived++;
+    
+    CFTimeInterval elapsed = CACurrentMediaTime() - self.lastPartialTranscriptTime;
+    
+    if (partialTranscript.done || elapsed >= PARTIAL_TRANSCRIPT_INTERVAL) {
+        [self flushPartialTranscript];
+    } else if (!displayScheduled) {
+        __weak typeof(self) weakSelf = self;
+        
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)((PARTIAL_TRANSCRIPT_INTERVAL - elapsed) * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            [weakSelf flushPartialTranscript];
+        });
+    }
+}
+
+- (void)flushPartialTranscript
+{
+    if (!self.pendingPartialTranscript) {
+        return;
+    }
+    
+    CFTimeInterval start = CACurrentMediaTime();
+    
+    self.updateText = self.pendingPartialTranscript.partialTranscript;
+    
+    self.pendingPartialTranscript = nil;
+    self.lastPartialTranscriptTime = CACurrentMediaTime();
+    self.partialTranscriptsDisplayed++;
+    self.partialTranscriptDisplayTime += self.lastPartialTranscriptTime - start;
+}
+
+- (void)logPartialTranscriptDisplayTime
+{
+    if (self.partialTranscriptsDisplayed == 0) {
+        return;
+    }
+    
+    // Without the rate limit every partial transcript received would have been displayed, at
+    // about the same cost each.
+    CFTimeInterval unlimitedTime = self.partialTranscriptDisplayTime / self.partialTranscriptsDisplayed * self.partialTranscriptsReceived;
+    
+    NSLog(@"Displayed %lu of %lu partial transcripts in %.1f ms on the main thread (about %.1f ms without rate limiting)",
+          (unsigned long)self.partialTranscriptsDisplayed, (unsigned long)self.partialTranscriptsReceived,
+          self.partialTranscriptDisplayTime * 1000.0, unlimitedTime * 1000.0);
+}
+
+#pragma mark - Speculative Text Search
+
+- (void)speculateWithPartialTranscript:(HoundDataPartialTranscript *)partialTranscript
+{
+    // Short commands are often fully transcribed well before the voice response arrives. Once
+    // a partial transcript has stayed the same for SPECULATIVE_SEARCH_INTERVAL seconds, run a
+    // text search for it in parallel. If the final transcript matches, the text search result
+    // is used and the voice query is cancelled. Otherwise the text search is cancelled.
+    // Each speculative search is an extra query, so this is off unless SPECULATIVE_SEARCH_INTERVAL
+    // is set above 0; 0.6 seconds works well.
+    
+    if (SPECULATIVE_SEARCH_INTERVAL <= 0) {
+        return;
+    }
+    
+    NSString *text = partialTranscript.partialTranscript;
+    
+    if (partialTranscript.done) {
+        self.finalTranscript = text;
+        self.finalTranscriptTime = CACurrentMediaTime();
+        
+        [self tryUseSpeculativeResult];
+        return;
+    }
+    
+    if (text.length == 0 || [text isEqualToString:self.stablePartialText]) {
+        return;
+    }
+    
+    // The generation changes with every new partial, so a timer from before the text changed
+    // does not fire early if the text later changes back.
+    self.stablePartialText = text;
+    self.stablePartialGeneration++;
+    
+    NSUInteger generation = self.stablePartialGeneration;
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(SPECULATIVE_SEARCH_INTERVAL * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [self startSpeculativeSearchWithText:text generation:generation];
+    });
+}
+
+- (void)startSpeculativeSearchWithText:(NSString *)text generation:(NSUInteger)generation
+{
+    // Only search if the transcript has not changed since it was scheduled, and the voice
+    // query has not already produced its final transcript.
+    
+    if (!self.query.isActive || self.finalTranscript || generation != self.stablePartialGeneration) {
+        return;
+    }
+    
+    [self cancelSpeculativeSearch];
+    
+    // Configure the text search with the same RequestInfo as the voice query.
+    self.speculativeQuery = [[HoundTextSearch instance] newTextSearchWithSearchText:text];
+    
+    [self configureRequestInfoBuilder:self.speculativeQuery.requestInfoBuilder];
+    
+    self.speculativeSearchesStarted++;
+    
+    [self.speculativeQuery startWithCompletion:^(HoundTextSearchQuery *query, HoundDataHoundServer *response, NSError *error) {
+        if (query == self.speculativeQuery) {
+            [self tryUseSpeculativeResult];
+        }
+    }];
+}
+
+- (void)tryUseSpeculativeResult
+{
+    HoundTextSearchQuery *speculativeQuery = self.speculativeQuery;
+    
+    if (!speculativeQuery || !self.finalTranscript || self.usedSpeculativeResult) {
+        return;
+    }
+    
+    // The user kept talking after the transcript looked stable, or the text search failed:
+    // let the voice query finish normally.
+    if ([speculativeQuery.searchText caseInsensitiveCompare:self.finalTranscript] != NSOrderedSame || speculativeQuery.error) {
+        [self cancelSpeculativeSearch];
+        return;
+    }
+    
+    // Still waiting for the text search response
+    if (!speculativeQuery.response) {
+        return;
+    }
+    
+    self.usedSpeculativeResult = YES;
+    self.speculativeSearchesUsed++;
+    
+    NSLog(@"Speculative text search used for %lu of %lu attempts", (unsigned long)self.speculativeSearchesUsed, (unsigned long)self.speculativeSearchesStarted);
+    
+    [self.query cancel];
+    
+    // The text search result needs the same client-side completion as a voice search result.
+    [self tryUpdateQueryResponse:speculativeQuery.response];
+    
+    [self displaySearchResult:speculativeQuery.response dictionary:speculativeQuery.dictionary];
+    
+    self.speculativeSpeechStarted = NO;
+    
+    [speculativeQuery speakResponse];
+    
+    [self refreshUI];
+    [self watchSpeculativeSpeech];
+}
+
+- (BOOL)speakingSpeculativeResult
+{
+    // The text search that answered the current voice query is kept until it has been spoken.
+    return self.usedSpeculativeResult && self.speculativeQuery != nil;
+}
+
+- (void)watchSpeculativeSpeech
+{
+    // HoundTextSearchQuery does not report when it finishes speaking, so check isSpeaking
+    // periodically. Once the response has been spoken, refresh the UI and start any follow-up query.
+    // Speech can take a moment to start, so isSpeaking == NO only means it has finished once it
+    // has been seen speaking, or once the canceled voice query has finished.
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(SPECULATIVE_SPEECH_POLL_INTERVAL * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        if (!self.speakingSpeculativeResult) {
+            return;
+        }
+        
+        if (self.speculativeQuery.isSpeaking) {
+            self.speculativeSpeechStarted = YES;
+        }
+        
+        if (self.speculativeQuery.isSpeaking ||
+            (!self.speculativeSpeechStarted && self.query.state != HoundVoiceSearchQueryStateFinished)) {
+            [self watchSpeculativeSpeech];
+            return;
+        }
+        
+        self.speculativeQuery = nil;
+        
+        [self refreshUI];
+        [self startNextQuery];
+    });
+}
+
+- (void)cancelSpeculativeSearch
+{
+    HoundTextSearchQuery *speculativeQuery = self.speculativeQuery;
+    
+    self.speculativeQuery = nil;
+    
+    [speculativeQuery cancel];
+    [speculativeQuery stopSpeaking];
+}
+
 #pragma mark - Client Integration Example
 
-- (void)tryUpdateQueryResponse:(HoundVoiceSearchQuery *)query
+- (void)tryUpdateQueryResponse:(HoundDataHoundServer *)response
 {
     // Some HoundServer responses need information from the client before they are "complete"
     // For more general information, start here: https://www.houndify.com/docs#dynamic-responses
@@ -299,7 +679,7 @@
     // "Clear the screen" to try it.
     
     // First, let's make sure we've got a ClientClearScreenCommand to work with.
-    HoundDataCommandResult *commandResult = query.response.allResults.firstObject;
+    HoundDataCommandResult *commandResult = response.allResults.firstObject;
     
     // See HoundDataCommandResult-Extras.m for the implementation of isClientClearScreenCommand
     if (!commandResult.isClientClearScreenCommand) {
@@ -400,6 +780,15 @@
 
 - (IBAction)didTapStartButton:(id)sender
 {
+    // Stop a speculative text search response that is being spoken in place of the voice query's.
+    if (self.speakingSpeculativeResult) {
+        // Interrupting the response also declines to answer it.
+        self.nextQuery = nil;
+        [self cancelSpeculativeSearch];
+        [self refreshUI];
+        return;
+    }
+    
     // Begin a voice search if this is the first one.
     if (!self.query) {
         [self blankTextView];
@@ -420,10 +809,12 @@
             [self resetTextView];
             break;
         case HoundVoiceSearchQueryStateSearching:
-            [self.query cancel];
+            [self cancelSearch];
             [self resetTextView];
             break;
         case HoundVoiceSearchQueryStateSpeaking:
+            // Interrupting the response also declines to answer it.
+            self.nextQuery = nil;
             [self.query stopSpeaking];
             break;
 
@@ -454,9 +845,13 @@
 - (void)setUpdateText:(NSString *)updateText
 {
     if (![_updateText isEqual:updateText]) {
+        NSString *previousText = _updateText;
+        
         _updateText = [updateText copy];
         
-        [self refreshTextView];
+        if (![self patchTextViewFromText:previousText]) {
+            [self refreshTextView];
+        }
     }
 }
 
@@ -495,6 +890,34 @@
     }
 }
 
+- (BOOL)patchTextViewFromText:(NSString *)previousText
+{
+    // Successive partial transcripts usually differ only at the end. If the text view is
+    // showing the previous transcript, replace just the part after the common prefix rather
+    // than resetting the whole text and laying it out again.
+    
+    if (self.responseText.length > 0 || previousText.length == 0 || self.updateText.length == 0) {
+        return NO;
+    }
+    
+    if (![self.textView.text isEqualToString:previousText]) {
+        return NO;
+    }
+    
+    NSUInteger stableLength = [previousText commonPrefixWithString:self.updateText options:NSLiteralSearch].length;
+    
+    if (stableLength == 0) {
+        return NO;
+    }
+    
+    NSRange changedRange = NSMakeRange(stableLength, previousText.length - stableLength);
+    
+    [self.textView.textStorage replaceCharactersInRange:changedRange
+                                             withString:[self.updateText substringFromIndex:stableLength]];
+    
+    return YES;
+}
+
 - (void)updateStatus:(NSString *)status
 {
     self.statusLabel.text = status;
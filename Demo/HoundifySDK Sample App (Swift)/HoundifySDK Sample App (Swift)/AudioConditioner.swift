@@ -0,0 +1,181 @@
+//
+//  AudioConditioner.swift
+//  HoundifySDK Sample App (Swift)
+//
+//  Created by SoundHound on 10/19/26.
+//  Copyright © 2026 SoundHound. All rights reserved.
+//
+
+import Foundation
+import Accelerate
+import QuartzCore
+
+// Cleans up 16 bit linear PCM audio before it is passed to the SDK in raw mode.
+//
+// Each buffer is run through a high-pass filter, which removes low frequency rumble such as
+// road and engine noise. The conditioner then keeps a running estimate of the background
+// noise level. Buffers well above it are treated as speech and brought towards targetLevel.
+// Other buffers are treated as noise: they are never boosted, and are pulled down by
+// noiseAttenuation.
+//
+// All processing uses Accelerate, without allocating once every output buffer has been used,
+// so it can run on the audio thread. An instance keeps filter and gain state between buffers
+// and must only be used from one thread at a time.
+
+class AudioConditioner {
+
+	// The level, in dBFS, that speech is brought towards.
+	var targetLevel: Float = -20
+
+	// The largest boost, in dB, applied to quiet speech.
+	var maximumGain: Float = 18
+
+	// How far above the background noise, in dB, a buffer must be to count as speech.
+	var speechMargin: Float = 10
+
+	// Attenuation, in dB, applied to buffers treated as noise.
+	var noiseAttenuation: Float = 12
+
+	// The number of buffers processed, and the total time spent processing them.
+	private(set) var processedBufferCount = 0
+	private(set) var processingTime: TimeInterval = 0
+
+	// The largest buffer Core Audio delivers in one render callback (the default
+	// kAudioUnitProperty_MaximumFramesPerSlice). Longer buffers are passed on unchanged.
+	static let maximumFrameCount = 4096
+
+	private let highPassFrequency = 120.0
+	private let gainAttackTime = 0.01
+	private let gainReleaseTime = 0.5
+	private let noiseGateOpenTime = 0.01
+	private let noiseGateCloseTime = 0.2
+
+	// Time constants for the background noise estimate to rise towards the current level, in quiet
+	// audio and in audio classified as speech, as in VoiceActivityDetector
+	private let noiseTimeConstant: TimeInterval = 2
+	private let loudNoiseTimeConstant: TimeInterval = 10
+
+	private let sampleRate: Double
+	private let highPass: vDSP_biquad_Setup
+	private var highPassDelay = [Float](repeating: 0, count: 4)
+	private var samples = [Float](repeating: 0, count: AudioConditioner.maximumFrameCount)
+
+	// Conditioned audio is written into a ring of reused buffers rather than a new Data each time.
+	// The ring holds more audio than SpeechGate's look-back, so a buffer has normally been released
+	// by the time it comes round again. If it is still in use, Data copies it on write, so reuse is
+	// always safe.
+	private var outputBuffers = [Data](repeating: Data(), count: 128)
+	private var nextOutputBuffer = 0
+
+	private var noiseLevel: Float?
+	private var agcGain: Float = 0
+	private var speechAmount: Float = 0
+	private var gain: Float = 0
+
+	init(sampleRate: Double) {
+		self.sampleRate = sampleRate
+
+		// Second order Butterworth high-pass, from the Audio EQ Cookbook
+		let w0 = 2 * Double.pi * highPassFrequency / sampleRate
+		let alpha = sin(w0) / (2 * 0.5.squareRoot())
+		let a0 = 1 + alpha
+
+		let coefficients = [
+			(1 + cos(w0)) / 2 / a0,
+			-(1 + cos(w0)) / a0,
+			(1 + cos(w0)) / 2 / a0,
+			-2 * cos(w0) / a0,
+			(1 - alpha) / a0,
+		]
+
+		highPass = vDSP_biquad_CreateSetup(coefficients, 1)!
+	}
+
+	deinit {
+		vDSP_biquad_DestroySetup(highPass)
+	}
+
+	// Sets processedBufferCount and processingTime back to zero.
+	func resetStatistics() {
+		processedBufferCount = 0
+		processingTime = 0
+	}
+
+	func process(_ data: Data) -> Data {
+		let count = data.count / MemoryLayout<Int16>.size
+
+		guard count > 0 && count <= AudioConditioner.maximumFrameCount else { return data }
+
+		let start = CACurrentMediaTime()
+
+		var rms: Float = 0
+
+		data.withUnsafeBytes { (bytes: UnsafeRawBufferPointer) in
+			samples.withUnsafeMutableBufferPointer { buffer in
+				vDSP_vflt16(bytes.bindMemory(to: Int16.self).baseAddress!, 1, buffer.baseAddress!, 1, vDSP_Length(count))
+				vDSP_biquad(highPass, &highPassDelay, buffer.baseAddress!, 1, buffer.baseAddress!, 1, vDSP_Length(count))
+				vDSP_rmsqv(buffer.baseAddress!, 1, &rms, vDSP_Length(count))
+			}
+		}
+
+		let level = 20 * log10(max(rms / 32768, 1e-6))
+		let duration = TimeInterval(count) / sampleRate
+
+		let currentNoiseLevel = noiseLevel ?? level
+		let speech = level > currentNoiseLevel + speechMargin
+
+		// Follow the background noise down immediately, and up slowly
+		if level < currentNoiseLevel {
+			noiseLevel = level
+		} else {
+			let timeConstant = speech ? loudNoiseTimeConstant : noiseTimeConstant
+			noiseLevel = currentNoiseLevel + (level - currentNoiseLevel) * Float(min(duration / timeConstant, 1))
+		}
+
+		if speech {
+			// Adapt the automatic gain towards the target level, turning it down quickly and up slowly
+			let agcTarget = min(targetLevel - level, maximumGain)
+			let timeConstant = agcTarget < agcGain ? gainAttackTime : gainReleaseTime
+
+			agcGain += (agcTarget - agcGain) * Float(1 - exp(-duration / timeConstant))
+		}
+
+		// Let speech through quickly when it starts, and suppress noise more slowly once it ends
+		let gateTimeConstant = speech ? noiseGateOpenTime : noiseGateCloseTime
+
+		speechAmount += ((speech ? 1 : 0) - speechAmount) * Float(1 - exp(-duration / gateTimeConstant))
+
+		// Noise is never boosted, even when quiet speech is
+		let noiseGain = min(agcGain, 0) - noiseAttenuation
+		let previousGain = gain
+
+		gain = speechAmount * agcGain + (1 - speechAmount) * noiseGain
+
+		// Ramp from the previous gain across the buffer to avoid clicks
+		var startScale = pow(10, previousGain / 20)
+		var step = (pow(10, gain / 20) - startScale) / Float(count)
+		var low = Float(Int16.min)
+		var high = Float(Int16.max)
+
+		let index = nextOutputBuffer
+		nextOutputBuffer = (nextOutputBuffer + 1) % outputBuffers.count
+
+		if outputBuffers[index].count != data.count {
+			outputBuffers[index] = Data(count: data.count)
+		}
+
+		samples.withUnsafeMutableBufferPointer { buffer in
+			vDSP_vrampmul(buffer.baseAddress!, 1, &startScale, &step, buffer.baseAddress!, 1, vDSP_Length(count))
+			vDSP_vclip(buffer.baseAddress!, 1, &low, &high, buffer.baseAddress!, 1, vDSP_Length(count))
+
+			outputBuffers[index].withUnsafeMutableBytes { (bytes: UnsafeMutableRawBufferPointer) in
+				vDSP_vfixr16(buffer.baseAddress!, 1, bytes.bindMemory(to: Int16.self).baseAddress!, 1, vDSP_Length(count))
+			}
+		}
+
+		processedBufferCount += 1
+		processingTime += CACurrentMediaTime() - start
+
+		return outputBuffers[index]
+	}
+}
@@ -110,6 +110,8 @@ class HoundifyViewController: UIViewController {
                                                            completion:
             
             { (query) in
+                self.displayedQuery = query
+                
                 if let error = query.error as NSError? {
                     self.updateText = "\(error.domain) \(error.code) \(error.localizedDescription)"
                 } else if let dictionary = query.dictionary {
@@ -120,7 +122,12 @@ class HoundifyViewController: UIViewController {
                     if let exampleText = commandResult?.exampleResultText() {
                         self.responseText = exampleText
                     } else {
-                        self.responseText = JSONAttributedFormatter.attributedString(from: dictionary, style: nil)
+                        // Format the response off the main thread, and drop it if another search has started since.
+                        JSONAttributedFormatter.attributedString(from: dictionary, style: nil, queue: .main) { attributedString in
+                            if query === self.displayedQuery {
+                                self.responseText = attributedString
+                            }
+                        }
                     }
                 }
                 
@@ -220,7 +227,12 @@ class HoundifyViewController: UIViewController {
         }
     }
     
+    // The query whose response is being displayed. Formatting finishes asynchronously, so results for
+    // any other query are dropped.
+    private var displayedQuery: HoundVoiceSearchQuery?
+    
     private func resetTextView() {
+        displayedQuery = nil
         updateText = nil
         responseText = nil
     }
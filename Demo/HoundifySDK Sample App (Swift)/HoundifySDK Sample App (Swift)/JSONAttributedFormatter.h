@@ -29,4 +29,14 @@ NS_ASSUME_NONNULL_END
 + (NSAttributedString* __nonnull)attributedStringFromObject:(id __nonnull)object
     style:(JSONAttributedFormatterStyle* __nullable)style;
 
+/**
+ Formats object on a background queue, then calls completion on queue.
+ Formatting a large response can take long enough to hold up rendering, so
+ prefer this to formatting on the main thread.
+ */
++ (void)attributedStringFromObject:(id __nonnull)object
+    style:(JSONAttributedFormatterStyle* __nullable)style
+    queue:(dispatch_queue_t __nonnull)queue
+    completion:(void (^ __nonnull)(NSAttributedString* __nonnull attributedString))completion;
+
 @end
@@ -20,6 +20,99 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
     
     private var query: HoundVoiceSearchQuery?
     
+    // Partial transcripts are displayed at most once per partialTranscriptInterval
+    private let partialTranscriptInterval: CFTimeInterval = 0.1
+    private var pendingPartialTranscript: HoundDataPartialTranscript?
+    private var lastPartialTranscriptTime: CFTimeInterval = 0
+    private var partialTranscriptsReceived = 0
+    private var partialTranscriptsDisplayed = 0
+    private var partialTranscriptDisplayTime: CFTimeInterval = 0
+    
+    // Finish recording as soon as the server reports it has enough audio
+    private let stopRecordingWhenSafe = false
+    
+    // Time of the last cancel(), used to measure how long the query takes to finish
+    private var cancelTime: CFTimeInterval = 0
+    
+    // Detect end of speech in the app from the raw audio, instead of in the SDK. Off by default;
+    // compare against the SDK's own detection before enabling it.
+    private let useLocalEndOfSpeechDetection = false
+    private var localEndOfSpeechDetection = false
+    
+    // Length of audio kept from before the start of speech when leading silence is held back (0 disables).
+    // Off by default; 0.3 works well.
+    private let leadingSilenceGuardInterval: TimeInterval = 0
+    
+    // Length of audio kept from before the start of speech when gating the hot phrase spotter (0 disables)
+    private let hotPhraseGuardInterval: TimeInterval = 0.5
+    
+    // Filter and level the audio before passing it to the SDK. Off by default; measure transcription
+    // quality before enabling it.
+    private let useAudioConditioning = false
+    private var audioConditioner: AudioConditioner?
+    
+    // endOfSpeechDetector, leadingSilenceGate, finishRecordingRequested and hotPhraseGate are used on the audio thread,
+    // so access is guarded by a lock
+    private let audioStateLock = NSLock()
+    private var _endOfSpeechDetector: VoiceActivityDetector?
+    private var endOfSpeechDetector: VoiceActivityDetector? {
+        get {
+            audioStateLock.lock()
+            defer { audioStateLock.unlock() }
+            return _endOfSpeechDetector
+        }
+        set {
+            audioStateLock.lock()
+            _endOfSpeechDetector = newValue
+            audioStateLock.unlock()
+        }
+    }
+    
+    private var _leadingSilenceGate: SpeechGate?
+    private var leadingSilenceGate: SpeechGate? {
+        get {
+            audioStateLock.lock()
+            defer { audioStateLock.unlock() }
+            return _leadingSilenceGate
+        }
+        set {
+            audioStateLock.lock()
+            _leadingSilenceGate = newValue
+            audioStateLock.unlock()
+        }
+    }
+    
+    private var _finishRecordingRequested = false
+    private var finishRecordingRequested: Bool {
+        get {
+            audioStateLock.lock()
+            defer { audioStateLock.unlock() }
+            return _finishRecordingRequested
+        }
+        set {
+            audioStateLock.lock()
+            _finishRecordingRequested = newValue
+            audioStateLock.unlock()
+        }
+    }
+    
+    private var _hotPhraseGate: SpeechGate?
+    private var hotPhraseGate: SpeechGate? {
+        get {
+            audioStateLock.lock()
+            defer { audioStateLock.unlock() }
+            return _hotPhraseGate
+        }
+        set {
+            audioStateLock.lock()
+            _hotPhraseGate = newValue
+            audioStateLock.unlock()
+        }
+    }
+    
+    // Tracks the background noise across queries. Only used on the audio thread, so it needs no lock.
+    private var ambientNoiseDetector: VoiceActivityDetector?
+    
     var originalTextViewFont: UIFont?
     var originalTextViewColor: UIColor?
 
@@ -55,6 +148,9 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
         NotificationCenter.default.addObserver(self, selector: #selector(hotPhrase), name: .HoundVoiceSearchHotPhrase, object: nil)
         
         NotificationCenter.default.addObserver(self, selector: #selector(applicationWillResignActive(_:)), name: UIApplication.willResignActiveNotification, object: nil)
+        
+        // Hot phrase detection may have been switched on or off in Settings
+        updateHotPhraseGate()
     }
     
     override func viewWillDisappear(_ animated: Bool) {
@@ -149,7 +245,12 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
                     print(errorString)
                     self.setupState = .notSetUp
                 } else {
+                    if self.useAudioConditioning {
+                        self.audioConditioner = AudioConditioner(sampleRate: AVAudioSession.sharedInstance().sampleRate)
+                    }
+                    
                     self.setupState = .setUp
+                    self.startHotPhraseGate()
                     self.refreshUI()
                     self.resetTextView()
                 }
@@ -162,7 +263,124 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
         // When using HoundVoiceSearch in raw mode, the application is responsible for continuously passing audio data
         // to the SDK
         
-        HoundVoiceSearch.instance().writeRawAudioData(data)
+        // Noisy audio, such as audio recorded in a car, produces long, low confidence transcriptions.
+        // audioConditioner filters out low frequency noise and evens out the level of the audio before
+        // it reaches the SDK's phrase spotter and encoder. See AudioConditioner.swift for its settings.
+        
+        // The conditioner reuses its output buffers, so it does not allocate on the audio thread once
+        // it has run for a moment.
+        
+        let conditionedData = audioConditioner?.process(data) ?? data
+        
+        // While a search is waiting for the user to start speaking, leadingSilenceGate holds the audio
+        // back, so that silence is not uploaded. The gate releases the audio from just before speech starts.
+        
+        // Between searches, hotPhraseGate does the same for the SDK's hot phrase spotter, so that the
+        // spotter only runs while someone might be speaking. The setting is checked on every buffer, because
+        // it can be switched off in Settings while the gate is installed.
+        
+        // The gates and endOfSpeechDetector measure speech against the background noise, so they are
+        // given the unconditioned audio. Conditioning changes the level of the noise and would skew them.
+        
+        let gate = leadingSilenceGate ?? (HoundVoiceSearch.instance().enableHotPhraseDetection ? hotPhraseGate : nil)
+        if let gate = gate {
+            seedNoiseLevel(of: gate.detector)
+        }
+        
+        let audio = gate?.process(conditionedData, detectionData: data) ?? [conditionedData]
+        
+        for buffer in audio {
+            HoundVoiceSearch.instance().writeRawAudioData(buffer)
+        }
+        
+        if finishRecordingRequested {
+            finishRecordingRequested = false
+            
+            releaseLeadingSilence()
+            
+            DispatchQueue.main.async {
+                if self.query?.state == .recording {
+                    self.query?.finishRecording()
+                }
+            }
+        }
+        
+        detectEndOfSpeech(in: data)
+        trackAmbientNoise(in: data)
+    }
+    
+    private func trackAmbientNoise(in data: Data) {
+        // Called on the audio thread.
+        
+        // Detectors created for a query start from this estimate instead of from the first buffer
+        // they see, which may be speech when a search starts mid-utterance, for example after the
+        // hot phrase.
+        
+        if ambientNoiseDetector == nil {
+            let detector = VoiceActivityDetector(sampleRate: AVAudioSession.sharedInstance().sampleRate)
+            detector.leadingSilenceDuration = 0
+            detector.maximumSpeechDuration = 0
+            ambientNoiseDetector = detector
+        }
+        
+        _ = ambientNoiseDetector?.process(data)
+    }
+    
+    private func releaseLeadingSilence() {
+        // Called on the audio thread, before recording finishes. While the leading silence gate is
+        // closed it holds the most recent audio, which may include speech it has not recognized yet.
+        // Pass that on rather than finish the query without it.
+        
+        guard let gate = leadingSilenceGate, !gate.isOpen else { return }
+        
+        for buffer in gate.open() {
+            HoundVoiceSearch.instance().writeRawAudioData(buffer)
+        }
+    }
+    
+    private func finishRecording() {
+        // The leading silence gate is only used on the audio thread, so let the audio thread release
+        // what it holds and then finish recording.
+        
+        if leadingSilenceGate != nil {
+            finishRecordingRequested = true
+        } else {
+            query?.finishRecording()
+        }
+    }
+    
+    private func seedNoiseLevel(of detector: VoiceActivityDetector) {
+        // Called on the audio thread.
+        
+        if detector.noiseLevel == nil, let noiseLevel = ambientNoiseDetector?.noiseLevel {
+            detector.seed(noiseLevel: noiseLevel)
+        }
+    }
+    
+    private func detectEndOfSpeech(in data: Data) {
+        // Called on the audio thread.
+        
+        guard let detector = endOfSpeechDetector else { return }
+        
+        seedNoiseLevel(of: detector)
+        
+        let event = detector.process(data)
+        
+        guard event == .speechEnded || event == .noSpeech else { return }
+        
+        endOfSpeechDetector = nil
+        
+        releaseLeadingSilence()
+        
+        let duration = Int(detector.processedDuration * 1000)
+        
+        DispatchQueue.main.async {
+            if self.query?.state == .recording {
+                print("Local end of speech detected after \(duration) ms\(event == .noSpeech ? " (no speech)" : "")")
+                
+                self.query?.finishRecording()
+            }
+        }
     }
     
     func startSearch() {
@@ -184,15 +402,127 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
         query?.requestInfoBuilder.positionTime = Int(Date().timeIntervalSince1970)
         query?.requestInfoBuilder.positionHorizontalAccuracy = 10
         
+        partialTranscriptsReceived = 0
+        partialTranscriptsDisplayed = 0
+        partialTranscriptDisplayTime = 0
+        cancelTime = 0
+        finishRecordingRequested = false
+        audioConditioner?.resetStatistics()
+        
+        // Since the application has the raw audio, it can decide for itself when the user has
+        // finished speaking, instead of relying on the SDK. See VoiceActivityDetector.swift for
+        // the settings that control how quickly end of speech is detected. maximumSpeechDuration also
+        // ends recording if the detector never hears the speech end, for example in rising noise.
+        
+        localEndOfSpeechDetection = useLocalEndOfSpeechDetection && query?.automaticEndOfSpeech == true
+        
+        if localEndOfSpeechDetection {
+            query?.automaticEndOfSpeech = false
+            endOfSpeechDetector = VoiceActivityDetector(sampleRate: AVAudioSession.sharedInstance().sampleRate)
+        }
+        
+        // The leading silence gate is only used with local end of speech detection, because the SDK's
+        // own detection needs the silence to notice that the user has not spoken. Its detector starts
+        // from the ambient noise estimate, since a search started by the hot phrase begins while the
+        // user is still speaking.
+        
+        if localEndOfSpeechDetection && leadingSilenceGuardInterval > 0 {
+            leadingSilenceGate = SpeechGate(sampleRate: AVAudioSession.sharedInstance().sampleRate, lookBackDuration: leadingSilenceGuardInterval)
+        }
+        
+        stopHotPhraseGate()
+        
         query?.start()
     }
+    
+    func cancelSearch() {
+        // The SDK reports the cancellation asynchronously. If the query is still recording, for example
+        // when the app resigns active, stop feeding it right away instead: drop any audio held by the
+        // leading silence gate and stop listening for end of speech.
+        
+        leadingSilenceGate = nil
+        endOfSpeechDetector = nil
+        pendingPartialTranscript = nil
+        
+        cancelTime = CACurrentMediaTime()
+        
+        query?.cancel()
+    }
 
+    // MARK: - Hot Phrase Gate
+    
+    private func startHotPhraseGate() {
+        // Spotting the hot phrase in every buffer, even in a silent room, is the largest cost of
+        // leaving hot phrase detection on. A voice activity detector is much cheaper to run, so use
+        // it to decide which audio is worth passing on to the spotter.
+        
+        guard hotPhraseGuardInterval > 0 && HoundVoiceSearch.instance().enableHotPhraseDetection && hotPhraseGate == nil else { return }
+        
+        let gate = SpeechGate(sampleRate: AVAudioSession.sharedInstance().sampleRate, lookBackDuration: hotPhraseGuardInterval)
+        
+        gate.closesAfterSpeech = true
+        gate.detector.leadingSilenceDuration = 0
+        
+        hotPhraseGate = gate
+    }
+    
+    private func updateHotPhraseGate() {
+        // enableHotPhraseDetection can change at any time, for example from SettingsViewController.
+        // passAudioData(_:) stops using the gate as soon as detection is switched off; this installs or
+        // removes the gate to match.
+        
+        if !HoundVoiceSearch.instance().enableHotPhraseDetection {
+            stopHotPhraseGate()
+        } else if setupState == .setUp && (query == nil || query?.state == .finished) {
+            startHotPhraseGate()
+        }
+    }
+    
+    private func stopHotPhraseGate() {
+        guard let gate = hotPhraseGate else { return }
+        
+        hotPhraseGate = nil
+        
+        let total = gate.passedByteCount + gate.discardedByteCount
+        
+        if total > 0 {
+            let percentage = Int((Double(gate.passedByteCount) * 100 / Double(total)).rounded())
+            print("Hot phrase spotter ran on \(percentage)% of idle audio (\(gate.passedByteCount) of \(total) bytes)")
+        }
+    }
+    
     // MARK: - HoundVoiceSearchQueryDelegate
     
     public func houndVoiceSearchQuery(_ query: HoundVoiceSearchQuery, changedStateFrom oldState: HoundVoiceSearchQueryState, to newState: HoundVoiceSearchQueryState) {
         refreshUI()
         
+        if oldState == .recording {
+            // Drop any partial transcript still waiting to be displayed, and stop listening for end of speech.
+            pendingPartialTranscript = nil
+            endOfSpeechDetector = nil
+            
+            if let gate = leadingSilenceGate {
+                leadingSilenceGate = nil
+                print("Uploaded \(gate.passedByteCount) bytes, held back \(gate.discardedByteCount) bytes of leading silence")
+            }
+        }
+        
         if newState == .finished {
+            startHotPhraseGate()
+            
+            if cancelTime > 0 {
+                print("Canceled query finished after \(Int((CACurrentMediaTime() - cancelTime) * 1000)) ms")
+                
+                cancelTime = 0
+            }
+            
+            logPartialTranscriptDisplayTime()
+            
+            if let conditioner = audioConditioner, conditioner.processedBufferCount > 0 {
+                let microseconds = conditioner.processingTime * 1_000_000 / Double(conditioner.processedBufferCount)
+                print("Audio conditioning: \(String(format: "%.1f", microseconds)) us per buffer over \(conditioner.processedBufferCount) buffers")
+            }
+            
             refreshTextView()
         }
     }
@@ -201,7 +531,17 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
         // While a voice query is being recorded, the HoundSDK will provide ongoing transcription
         // updates which can be displayed to the user.
         if query == self.query {
-            self.updateText = partialTranscript.partialTranscript
+            display(partialTranscript: partialTranscript)
+            
+            // When safeToStopAudio is set, the server already has all the audio it needs for this
+            // query. Rather than continuing to stream until end of speech is detected locally, the
+            // application may move the query on to Searching right away.
+            
+            if stopRecordingWhenSafe && partialTranscript.safeToStopAudio && (query.automaticEndOfSpeech || localEndOfSpeechDetection) && query.state == .recording {
+                print("Server has enough audio after \(partialTranscript.durationMS) ms, finishing recording")
+                
+                query.finishRecording()
+            }
         }
     }
     
@@ -220,7 +560,12 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
         if let exampleText = commandResult?.exampleResultText() {
             responseText = exampleText
         } else {
-            responseText = JSONAttributedFormatter.attributedString(from: dictionary, style: nil)
+            // Format the response off the main thread, and drop it if a new search has started since.
+            JSONAttributedFormatter.attributedString(from: dictionary, style: nil, queue: .main) { attributedString in
+                if self.query == query {
+                    self.responseText = attributedString
+                }
+            }
         }
         
         if let nativeData = commandResult?["NativeData"]
@@ -248,6 +593,52 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
         self.updateText = "Canceled"
     }
     
+    // MARK: - Partial Transcripts
+    
+    private func display(partialTranscript: HoundDataPartialTranscript) {
+        // On a fast connection partial transcripts can arrive faster than they can usefully be
+        // drawn. Display at most one every partialTranscriptInterval seconds, always the newest,
+        // and display the final one (done == true) immediately.
+        
+        let displayScheduled = pendingPartialTranscript != nil
+        
+        pendingPartialTranscript = partialTranscript
+        partialTranscriptsReceived += 1
+        
+        let elapsed = CACurrentMediaTime() - lastPartialTranscriptTime
+        
+        if partialTranscript.done || elapsed >= partialTranscriptInterval {
+            flushPartialTranscript()
+        } else if !displayScheduled {
+            DispatchQueue.main.asyncAfter(deadline: .now() + (partialTranscriptInterval - elapsed)) { [weak self] in
+                self?.flushPartialTranscript()
+            }
+        }
+    }
+    
+    private func flushPartialTranscript() {
+        guard let partialTranscript = pendingPartialTranscript else { return }
+        
+        let start = CACurrentMediaTime()
+        
+        updateText = partialTranscript.partialTranscript
+        
+        pendingPartialTranscript = nil
+        lastPartialTranscriptTime = CACurrentMediaTime()
+        partialTranscriptsDisplayed += 1
+        partialTranscriptDisplayTime += lastPartialTranscriptTime - start
+    }
+    
+    private func logPartialTranscriptDisplayTime() {
+        guard partialTranscriptsDisplayed > 0 else { return }
+        
+        // Without the rate limit every partial transcript received would have been displayed, at
+        // about the same cost each.
+        let unlimitedTime = partialTranscriptDisplayTime / Double(partialTranscriptsDisplayed) * Double(partialTranscriptsReceived)
+        
+        print("Displayed \(partialTranscriptsDisplayed) of \(partialTranscriptsReceived) partial transcripts in \(String(format: "%.1f", partialTranscriptDisplayTime * 1000)) ms on the main thread (about \(String(format: "%.1f", unlimitedTime * 1000)) ms without rate limiting)")
+    }
+    
     // MARK: - Client Integration Example
     
     public func tryUpdateQueryResponse(_ query: HoundVoiceSearchQuery) {
@@ -307,7 +698,7 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
     }
     
     @objc func applicationWillResignActive(_ notification: Notification) {
-        query?.cancel()
+        cancelSearch()
     }
     
     //MARK: IBActions
@@ -332,11 +723,11 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
             startSearch()
             
         case .recording:
-            query👍.finishRecording()
+            finishRecording()
             resetTextView()
             
         case .searching:
-            query👍.cancel()
+            cancelSearch()
             resetTextView()
             
         case .speaking:
@@ -363,7 +754,9 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
     
     private var updateText: String? {
         didSet {
-            refreshTextView()
+            if !patchTextView(from: oldValue) {
+                refreshTextView()
+            }
         }
     }
     
@@ -396,6 +789,29 @@ class RawVoiceSearchViewController: UIViewController, UISearchBarDelegate, Hound
         }
     }
     
+    private func patchTextView(from previousText: String?) -> Bool {
+        // Successive partial transcripts usually differ only at the end. If the text view is
+        // showing the previous transcript, replace just the part after the common prefix rather
+        // than resetting the whole text and laying it out again.
+        
+        guard responseText == nil,
+            let previousText = previousText, !previousText.isEmpty,
+            let updateText = updateText, !updateText.isEmpty,
+            textView.text == previousText else {
+            return false
+        }
+        
+        let previous = previousText as NSString
+        let stableLength = (previous.commonPrefix(with: updateText, options: .literal) as NSString).length
+        
+        guard stableLength > 0 else { return false }
+        
+        let changedRange = NSRange(location: stableLength, length: previous.length - stableLength)
+        textView.textStorage.replaceCharacters(in: changedRange, with: (updateText as NSString).substring(from: stableLength))
+        
+        return true
+    }
+    
     private func update(status: String?) {
         statusLabel.text = status
     }
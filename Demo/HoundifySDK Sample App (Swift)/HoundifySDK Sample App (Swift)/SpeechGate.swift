@@ -0,0 +1,97 @@
+//
+//  SpeechGate.swift
+//  HoundifySDK Sample App (Swift)
+//
+//  Created by SoundHound on 10/19/26.
+//  Copyright © 2026 SoundHound. All rights reserved.
+//
+
+import Foundation
+
+// Holds back 16 bit linear PCM audio until speech is detected.
+//
+// While the gate is closed, audio is kept in a short look-back buffer and older audio is
+// discarded. When the voice activity detector reports .speechStarted, the gate opens and returns the
+// look-back buffer along with the current audio, so the onset of speech is never lost.
+// Once open, the gate passes all audio through, unless closesAfterSpeech is set.
+//
+// Like VoiceActivityDetector, an instance must only be used from one thread at a time.
+
+class SpeechGate {
+
+	// The detector used to open the gate. Its settings may be adjusted before use.
+	let detector: VoiceActivityDetector
+
+	private(set) var isOpen = false
+
+	// If true, the gate closes again once the detector no longer hears speech.
+	var closesAfterSpeech = false
+
+	// Bytes of audio discarded while the gate was closed.
+	private(set) var discardedByteCount = 0
+
+	// Bytes of audio passed through the gate, including look-back audio.
+	private(set) var passedByteCount = 0
+
+	private var lookBack = [Data]()
+	private var lookBackByteCount = 0
+	private let lookBackCapacity: Int
+
+	init(sampleRate: Double, lookBackDuration: TimeInterval) {
+		detector = VoiceActivityDetector(sampleRate: sampleRate)
+		lookBackCapacity = Int(lookBackDuration * sampleRate) * MemoryLayout<Int16>.size
+	}
+
+	// Returns the audio to pass on, in order. Empty while the audio is being held back.
+	func process(_ data: Data) -> [Data] {
+		return process(data, detectionData: data)
+	}
+
+	// Like process(_:), but runs the detector on detectionData and passes on data. Use this when
+	// the audio sent on has been processed in a way that would mislead the detector, such as gain.
+	// Both buffers must cover the same stretch of audio.
+	func process(_ data: Data, detectionData: Data) -> [Data] {
+		let event = detector.process(detectionData)
+
+		if isOpen {
+			passedByteCount += data.count
+
+			if closesAfterSpeech && !detector.voiceActive && !detector.inSpeech {
+				isOpen = false
+			}
+
+			return [data]
+		}
+
+		lookBack.append(data)
+		lookBackByteCount += data.count
+
+		// Open on .speechStarted rather than voiceActive, so that a single click does not open the gate
+		guard event == .speechStarted else {
+			// Keep only as much audio as the look-back needs
+			while lookBack.count > 1 && lookBackByteCount - lookBack[0].count >= lookBackCapacity {
+				lookBackByteCount -= lookBack[0].count
+				discardedByteCount += lookBack[0].count
+				lookBack.removeFirst()
+			}
+
+			return []
+		}
+
+		return open()
+	}
+
+	// Opens the gate without waiting for speech, and returns the look-back audio to pass on first.
+	// Use this before the audio stops, so that the audio held back is not lost.
+	func open() -> [Data] {
+		let audio = lookBack
+
+		isOpen = true
+		passedByteCount += lookBackByteCount
+
+		lookBack.removeAll()
+		lookBackByteCount = 0
+
+		return audio
+	}
+}
@@ -15,6 +15,13 @@ class TextSearchViewController: UIViewController, HoundTextSearchQueryDelegate,
 	@IBOutlet weak var searchBar: UISearchBar!
     
     private var query: HoundTextSearchQuery?
+    
+    // The query whose response is being displayed. Formatting finishes asynchronously, so results for
+    // any other query are dropped.
+    private var displayedQuery: HoundTextSearchQuery?
+    
+    // Time of the last cancel(), used to measure how long the query takes to finish
+    private var cancelTime: CFTimeInterval = 0
 
     override var preferredStatusBarStyle : UIStatusBarStyle {
         return .lightContent
@@ -27,7 +34,8 @@ class TextSearchViewController: UIViewController, HoundTextSearchQueryDelegate,
         
         searchBar.text = "Searching: " + search
         
-        query?.cancel()
+        // Replace any search still running. Its callbacks are ignored from here on.
+        cancelSearch()
         
         query = HoundTextSearch.instance().newTextSearch(withSearchText: search)
         
@@ -48,8 +56,14 @@ class TextSearchViewController: UIViewController, HoundTextSearchQueryDelegate,
     // MARK: - HoundTextSearchQueryDelegate
     
     func houndTextSearchQuery(_ query: HoundTextSearchQuery, didReceiveSearchResult houndServer: HoundDataHoundServer, dictionary: [AnyHashable : Any]) {
+        guard query === self.query else {
+            return
+        }
+        
         searchBar.resignFirstResponder()
         
+        displayedQuery = query
+        
         // Domains that work with client features often return incomplete results that need
         // to be completed by the application before they are ready to use. See this method for
         // an example
@@ -62,7 +76,12 @@ class TextSearchViewController: UIViewController, HoundTextSearchQueryDelegate,
         if let exampleText = commandResult?.exampleResultText() {
             textView.attributedText = exampleText
         } else {
-            textView.attributedText = JSONAttributedFormatter.attributedString(from: dictionary, style: nil)
+            // Format the response off the main thread, and drop it if a new search has started since.
+            JSONAttributedFormatter.attributedString(from: dictionary, style: nil, queue: .main) { attributedString in
+                if query === self.displayedQuery {
+                    self.textView.attributedText = attributedString
+                }
+            }
         }
         
         if let nativeData = commandResult?["NativeData"]
@@ -76,10 +95,15 @@ class TextSearchViewController: UIViewController, HoundTextSearchQueryDelegate,
     }
     
     func houndTextSearchQuery(_ query: HoundTextSearchQuery, didFailWithError error: Error) {
+        guard query === self.query else {
+            return
+        }
+        
         searchBar.resignFirstResponder()
 
         let nserror = error as NSError
         
+        displayedQuery = nil
         textView.text = "\(nserror.domain) (\(nserror.code))\n\(nserror.localizedDescription)"
         
         searchBar.showsCancelButton = false
@@ -88,6 +112,18 @@ class TextSearchViewController: UIViewController, HoundTextSearchQueryDelegate,
     }
     
     func houndTextSearchQueryDidCancel(_ query: HoundTextSearchQuery) {
+        if cancelTime > 0 {
+            print("Canceled query finished after \(Int((CACurrentMediaTime() - cancelTime) * 1000)) ms")
+            
+            cancelTime = 0
+        }
+        
+        // A search replaced by a new one is canceled too. Leave the display to the new search.
+        guard query === self.query else {
+            return
+        }
+        
+        displayedQuery = nil
         self.textView.text = "Canceled"
 
         searchBar.showsCancelButton = false
@@ -95,6 +131,17 @@ class TextSearchViewController: UIViewController, HoundTextSearchQueryDelegate,
         self.query = nil
     }
     
+    private func cancelSearch() {
+        // The SDK reports the cancellation asynchronously. Stop displaying anything for this search
+        // in the meantime.
+        
+        displayedQuery = nil
+        
+        cancelTime = query != nil ? CACurrentMediaTime() : 0
+        
+        query?.cancel()
+    }
+    
     // MARK: - Client Integration Example
     
     public func tryUpdateQueryResponse(_ query: HoundTextSearchQuery) {
@@ -160,7 +207,7 @@ class TextSearchViewController: UIViewController, HoundTextSearchQueryDelegate,
 	func searchBarCancelButtonClicked(_ searchBar: UISearchBar) {
 		searchBar.resignFirstResponder()
         
-        query?.cancel()
+        cancelSearch()
     }
 	
 	func searchBarTextDidBeginEditing(_ searchBar: UISearchBar) {
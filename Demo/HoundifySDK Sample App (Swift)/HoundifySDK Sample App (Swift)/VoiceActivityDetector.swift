@@ -0,0 +1,186 @@
+//
+//  VoiceActivityDetector.swift
+//  HoundifySDK Sample App (Swift)
+//
+//  Created by SoundHound on 10/19/26.
+//  Copyright © 2026 SoundHound. All rights reserved.
+//
+
+import Foundation
+import Accelerate
+
+// An energy based voice activity detector for 16 bit linear PCM audio, as delivered by AudioTester.
+//
+// Each buffer passed to process(_:) is compared against a running estimate of the background
+// noise level. The timing properties control how quickly the start and end of speech are
+// reported, so end-of-speech detection can be tuned for the application.
+//
+// An instance keeps state between buffers and must only be used from one thread at a time.
+
+class VoiceActivityDetector {
+
+	enum Event {
+		case none
+		case speechStarted
+		case speechEnded
+		case noSpeech
+	}
+
+	// How far above the background noise, in dB, a buffer must be to count as speech.
+	var speechMargin: Float = 12
+
+	// Buffers quieter than this level, in dBFS, never count as speech.
+	var minimumSpeechLevel: Float = -50
+
+	// How long speech must last before .speechStarted is reported.
+	var minimumSpeechDuration: TimeInterval = 0.1
+
+	// How long voiceActive stays true after the level drops, bridging short gaps between words.
+	var hangoverDuration: TimeInterval = 0.2
+
+	// How long voiceActive must stay false after speech before .speechEnded is reported.
+	var trailingSilenceDuration: TimeInterval = 0.5
+
+	// If no speech starts within this time, .noSpeech is reported once. 0 waits indefinitely.
+	var leadingSilenceDuration: TimeInterval = 5
+
+	// If speech lasts this long, .speechEnded is reported anyway. 0 waits indefinitely.
+	var maximumSpeechDuration: TimeInterval = 15
+
+	// True if the most recent buffer, including hangover, was classified as speech.
+	private(set) var voiceActive = false
+
+	// True between .speechStarted and .speechEnded.
+	private(set) var inSpeech = false
+
+	// Total duration of audio processed since the last reset.
+	private(set) var processedDuration: TimeInterval = 0
+
+	// The background noise estimate, in dBFS, or nil before any audio has been processed.
+	private(set) var noiseLevel: Float?
+
+	// Time constants for the background noise estimate to rise towards the current level, in quiet
+	// audio and in audio classified as speech. Rising slowly during speech lets the estimate catch
+	// up with a sudden, lasting increase in background noise.
+	private let noiseTimeConstant: TimeInterval = 2
+	private let loudNoiseTimeConstant: TimeInterval = 10
+
+	private let sampleRate: Double
+	private var samples = [Float]()
+
+	private var loudDuration: TimeInterval = 0
+	private var quietDuration: TimeInterval = 0
+	private var speechDuration: TimeInterval = 0
+	private var heardSpeech = false
+	private var reportedNoSpeech = false
+
+	init(sampleRate: Double) {
+		self.sampleRate = sampleRate
+	}
+
+	// Clears all state, including the background noise estimate.
+	func reset() {
+		noiseLevel = nil
+		loudDuration = 0
+		quietDuration = 0
+		speechDuration = 0
+		heardSpeech = false
+		reportedNoSpeech = false
+		voiceActive = false
+		inSpeech = false
+		processedDuration = 0
+	}
+
+	// Starts the background noise estimate at noiseLevel instead of at the level of the first buffer.
+	// A detector created while the user may already be speaking should be seeded from one that has
+	// been listening for longer, or it would measure speech against speech.
+	func seed(noiseLevel: Float) {
+		self.noiseLevel = noiseLevel
+	}
+
+	func process(_ data: Data) -> Event {
+		let count = data.count / MemoryLayout<Int16>.size
+
+		guard count > 0 else { return .none }
+
+		let duration = TimeInterval(count) / sampleRate
+		let level = self.level(of: data, count: count)
+
+		processedDuration += duration
+
+		let currentNoiseLevel = noiseLevel ?? level
+		let loud = level > minimumSpeechLevel && level > currentNoiseLevel + speechMargin
+
+		noiseLevel = currentNoiseLevel
+
+		if loud {
+			loudDuration += duration
+			quietDuration = 0
+			voiceActive = true
+
+			noiseLevel = currentNoiseLevel + (level - currentNoiseLevel) * Float(min(duration / loudNoiseTimeConstant, 1))
+		} else {
+			loudDuration = 0
+			quietDuration += duration
+
+			if quietDuration >= hangoverDuration {
+				voiceActive = false
+			}
+
+			// Follow the background noise down immediately, and up slowly
+			if level < currentNoiseLevel {
+				noiseLevel = level
+			} else {
+				noiseLevel = currentNoiseLevel + (level - currentNoiseLevel) * Float(min(duration / noiseTimeConstant, 1))
+			}
+		}
+
+		if !inSpeech {
+			if loudDuration >= minimumSpeechDuration {
+				inSpeech = true
+				heardSpeech = true
+				speechDuration = 0
+				return .speechStarted
+			}
+
+			if !heardSpeech && !reportedNoSpeech && leadingSilenceDuration > 0 && processedDuration >= leadingSilenceDuration {
+				reportedNoSpeech = true
+				return .noSpeech
+			}
+		} else {
+			speechDuration += duration
+
+			if !voiceActive && quietDuration >= hangoverDuration + trailingSilenceDuration {
+				inSpeech = false
+				return .speechEnded
+			}
+
+			if maximumSpeechDuration > 0 && speechDuration >= maximumSpeechDuration {
+				// Require a fresh onset before speech is reported again
+				inSpeech = false
+				loudDuration = 0
+				return .speechEnded
+			}
+		}
+
+		return .none
+	}
+
+	fileprivate func level(of data: Data, count: Int) -> Float {
+		if samples.count < count {
+			samples = [Float](repeating: 0, count: count)
+		}
+
+		var rms: Float = 0
+
+		data.withUnsafeBytes { (bytes: UnsafeRawBufferPointer) in
+			samples.withUnsafeMutableBufferPointer { buffer in
+				vDSP_vflt16(bytes.bindMemory(to: Int16.self).baseAddress!, 1, buffer.baseAddress!, 1, vDSP_Length(count))
+				vDSP_rmsqv(buffer.baseAddress!, 1, &rms, vDSP_Length(count))
+			}
+		}
+
+		// RMS level in dBFS, floored at -120
+		return 20 * log10(max(rms / 32768, 1e-6))
+	}
+}
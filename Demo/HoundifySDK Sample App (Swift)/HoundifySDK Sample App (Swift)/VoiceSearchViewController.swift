@@ -19,6 +19,38 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
     
     private var query: HoundVoiceSearchQuery?
     
+    // Prepare the follow-up query while an autoListen response is speaking. Off by default.
+    private let pipelineAutoListen = false
+    private var nextQuery: HoundVoiceSearchQuery?
+    
+    // Partial transcripts are displayed at most once per partialTranscriptInterval
+    private let partialTranscriptInterval: CFTimeInterval = 0.1
+    private var pendingPartialTranscript: HoundDataPartialTranscript?
+    private var lastPartialTranscriptTime: CFTimeInterval = 0
+    private var partialTranscriptsReceived = 0
+    private var partialTranscriptsDisplayed = 0
+    private var partialTranscriptDisplayTime: CFTimeInterval = 0
+    
+    // Finish recording as soon as the server reports it has enough audio
+    private let stopRecordingWhenSafe = false
+    
+    // Run a speculative text search once a partial transcript has been stable this long (0 disables).
+    // Each speculative search is an extra query, so this is off by default; 0.6 works well.
+    private let speculativeSearchInterval: TimeInterval = 0
+    private let speculativeSpeechPollInterval: TimeInterval = 0.25
+    private var speculativeQuery: HoundTextSearchQuery?
+    private var stablePartialText: String?
+    private var stablePartialGeneration = 0
+    private var finalTranscript: String?
+    private var finalTranscriptTime: CFTimeInterval = 0
+    private var usedSpeculativeResult = false
+    private var speculativeSpeechStarted = false
+    private var speculativeSearchesStarted = 0
+    private var speculativeSearchesUsed = 0
+    
+    // Time of the last cancel(), used to measure how long the query takes to finish
+    private var cancelTime: CFTimeInterval = 0
+    
     var originalTextViewFont: UIFont?
     var originalTextViewColor: UIColor?
 
@@ -61,6 +93,9 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
         if let state = query?.state, state != .finished {
             searchButton.setTitle("Stop", for: .normal)
             searchButton.isEnabled = true
+        } else if speakingSpeculativeResult {
+            searchButton.setTitle("Stop", for: .normal)
+            searchButton.isEnabled = true
         } else {
             searchButton.setTitle("Search", for: .normal)
             searchButton.isEnabled = HoundVoiceSearch.instance().isListening
@@ -68,7 +103,7 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
         
         if !HoundVoiceSearch.instance().isListening {
             searchButton.backgroundColor = self.view.tintColor.withAlphaComponent(0.5)
-        } else if query?.state == .speaking {
+        } else if query?.state == .speaking || speakingSpeculativeResult {
             searchButton.backgroundColor = .red
         } else {
             searchButton.backgroundColor = self.view.tintColor
@@ -82,6 +117,8 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
             
         if (!HoundVoiceSearch.instance().isListening) {
             status = "Not Ready"
+        } else if speakingSpeculativeResult {
+            status = "Speaking"
         } else if let state = query?.state {
             switch state {
             case .recording: status = "Recording"
@@ -138,20 +175,48 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
         // To perform a voice search, create an instance of HoundVoiceSearchQuery
         // Configure it, including setting its delegate
         // And call start()
-
-        query = HoundVoiceSearch.instance().newVoiceSearch()
-        query?.delegate = self
         
+        nextQuery = nil
+        
+        start(query: prepareQuery())
+    }
+    
+    private func prepareQuery() -> HoundVoiceSearchQuery {
+        let query = HoundVoiceSearch.instance().newVoiceSearch()
+        query.delegate = self
+        
+        configure(requestInfoBuilder: query.requestInfoBuilder)
+        
+        return query
+    }
+    
+    private func start(query: HoundVoiceSearchQuery) {
+        self.query = query
+        
+        partialTranscriptsReceived = 0
+        partialTranscriptsDisplayed = 0
+        partialTranscriptDisplayTime = 0
+        cancelTime = 0
+        
+        cancelSpeculativeSearch()
+        
+        stablePartialText = nil
+        stablePartialGeneration += 1
+        finalTranscript = nil
+        usedSpeculativeResult = false
+        
+        query.start()
+    }
+    
+    private func configure(requestInfoBuilder: HoundRequestInfoBuilder) {
         // An example of how to use RequestInfo: set the location to SoundHound HQ.
         // a real application, of course, one would use location services to determine
         // the device's location.
         
-        query?.requestInfoBuilder.latitude = 37.4089054
-        query?.requestInfoBuilder.longitude = -121.9849621
-        query?.requestInfoBuilder.positionTime = Int(Date().timeIntervalSince1970)
-        query?.requestInfoBuilder.positionHorizontalAccuracy = 10
-        
-        query?.start()
+        requestInfoBuilder.latitude = 37.4089054
+        requestInfoBuilder.longitude = -121.9849621
+        requestInfoBuilder.positionTime = Int(Date().timeIntervalSince1970)
+        requestInfoBuilder.positionHorizontalAccuracy = 10
     }
     
     // MARK: - HoundVoiceSearchQueryDelegate
@@ -159,8 +224,27 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
     public func houndVoiceSearchQuery(_ query: HoundVoiceSearchQuery, changedStateFrom oldState: HoundVoiceSearchQueryState, to newState: HoundVoiceSearchQueryState) {
         refreshUI()
         
+        if oldState == .recording {
+            // Drop any partial transcript still waiting to be displayed.
+            pendingPartialTranscript = nil
+        }
+        
         if newState == .finished {
+            if query == self.query && cancelTime > 0 {
+                print("Canceled query finished after \(Int((CACurrentMediaTime() - cancelTime) * 1000)) ms")
+                
+                cancelTime = 0
+            }
+            
+            logPartialTranscriptDisplayTime()
+            
             refreshTextView()
+            
+            // A voice query canceled for a speculative result finishes while that result is still
+            // speaking; the follow-up starts from watchSpeculativeSpeech() instead.
+            if query == self.query && !speakingSpeculativeResult {
+                startNextQuery()
+            }
         }
     }
     
@@ -168,17 +252,46 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
         // While a voice query is being recorded, the HoundSDK will provide ongoing transcription
         // updates which can be displayed to the user.
         if query == self.query {
-            self.updateText = partialTranscript.partialTranscript
+            display(partialTranscript: partialTranscript)
+            speculate(with: partialTranscript)
+            
+            // When safeToStopAudio is set, the server already has all the audio it needs for this
+            // query. Rather than continuing to stream until end of speech is detected locally, the
+            // application may move the query on to Searching right away.
+            
+            if stopRecordingWhenSafe && partialTranscript.safeToStopAudio && query.automaticEndOfSpeech && query.state == .recording {
+                print("Server has enough audio after \(partialTranscript.durationMS) ms, finishing recording")
+                
+                query.finishRecording()
+            }
         }
     }
     
     public func houndVoiceSearchQuery(_ query: HoundVoiceSearchQuery, didReceiveSearchResult houndServer: HoundDataHoundServer, dictionary: [AnyHashable : Any]) {
         guard query == self.query else { return }
         
+        // The voice query answered first, so a speculative text search is no longer needed.
+        cancelSpeculativeSearch()
+        
         // Domains that work with client features often return incomplete results that need
         // to be completed by the application before they are ready to use. See this method for
         // an example
-        tryUpdateQueryResponse(query)
+        tryUpdateQueryResponse(houndServer)
+        
+        display(searchResult: houndServer, dictionary: dictionary)
+        
+        // It is the application's responsibility to initiate text-to-speech for the response
+        // if it is desired.
+        // The SDK provides the speakResponse() method on HoundVoiceSearchQuery, or the
+        // the application may use its own TTS support.
+        query.speakResponse()
+    }
+    
+    private func display(searchResult houndServer: HoundDataHoundServer, dictionary: [AnyHashable : Any]) {
+        if finalTranscript != nil {
+            let elapsed = Int((CACurrentMediaTime() - finalTranscriptTime) * 1000)
+            print("Result displayed \(elapsed) ms after final transcript\(usedSpeculativeResult ? " (speculative text search)" : "")")
+        }
         
         let commandResult = houndServer.allResults?.first
         
@@ -187,7 +300,14 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
         if let exampleText = commandResult?.exampleResultText() {
             responseText = exampleText
         } else {
-            responseText = JSONAttributedFormatter.attributedString(from: dictionary, style: nil)
+            // Format the response off the main thread, and drop it if a new search has started since.
+            let query = self.query
+            
+            JSONAttributedFormatter.attributedString(from: dictionary, style: nil, queue: .main) { attributedString in
+                if self.query == query {
+                    self.responseText = attributedString
+                }
+            }
         }
         
         if let nativeData = commandResult?["NativeData"]
@@ -195,29 +315,252 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
             print("NativeData: \(nativeData)")
         }
         
-        // It is the application's responsibility to initiate text-to-speech for the response
-        // if it is desired.
-        // The SDK provides the speakResponse() method on HoundVoiceSearchQuery, or the
-        // the application may use its own TTS support.
-        query.speakResponse()
-    }    
+        // Both voice and speculative text search results can ask for a follow-up.
+        if pipelineAutoListen, commandResult?.autoListen == true {
+            prepareNextQuery()
+        }
+    }
     
     public func houndVoiceSearchQuery(_ query: HoundVoiceSearchQuery, didFailWithError error: Error) {
         guard query == self.query else { return }
         
+        cancelSpeculativeSearch()
+        
+        nextQuery = nil
+        
         let nserror = error as NSError
         self.updateText = "\(nserror.domain) \(nserror.code) \(nserror.localizedDescription)"
     }
     
     public func houndVoiceSearchQueryDidCancel(_ query: HoundVoiceSearchQuery) {
-        guard query == self.query else { return }
+        // A voice query cancelled in favor of a speculative text search result is not shown as canceled.
+        guard query == self.query, !usedSpeculativeResult else { return }
+        
+        cancelSpeculativeSearch()
+        
+        nextQuery = nil
 
         self.updateText = "Canceled"
     }
     
+    func cancelSearch() {
+        // The SDK reports the cancellation asynchronously. Drop everything that would still act on
+        // this search in the meantime: the speculative text search, the follow-up query and any
+        // partial transcript waiting to be displayed.
+        
+        cancelSpeculativeSearch()
+        
+        nextQuery = nil
+        pendingPartialTranscript = nil
+        
+        cancelTime = CACurrentMediaTime()
+        
+        query?.cancel()
+    }
+    
+    // MARK: - Follow-up Queries
+    
+    private func prepareNextQuery() {
+        // When a result sets autoListen, the server expects the user to answer, and the application
+        // should start listening again once the response has been spoken. Build the follow-up query
+        // now, while the response is speaking, so that all that is left to do then is start it.
+        // The SDK carries the conversation state over, as it does for any other query.
+        
+        nextQuery = prepareQuery()
+    }
+    
+    private func startNextQuery() {
+        // Keep the follow-up until it can start. If the previous query is still finishing, this
+        // is called again when it reaches Finished.
+        
+        guard let nextQuery = nextQuery, !(query?.isActive == true) && HoundVoiceSearch.instance().isListening else { return }
+        
+        self.nextQuery = nil
+        
+        print("Starting follow-up query")
+        
+        blankTextView()
+        start(query: nextQuery)
+    }
+    
+    // MARK: - Partial Transcripts
+    
+    private func display(partialTranscript: HoundDataPartialTranscript) {
+        // On a fast connection partial transcripts can arrive faster than they can usefully be
+        // drawn. Display at most one every partialTranscriptInterval seconds, always the newest,
+        // and display the final one (done == true) immediately.
+        
+        let displayScheduled = pendingPartialTranscript != nil
+        
+        pendingPartialTranscript = partialTranscript
+        partialTranscriptsReceived += 1
+        
+        let elapsed = CACurrentMediaTime() - lastPartialTranscriptTime
+        
+        if partialTranscript.done || elapsed >= partialTranscriptInterval {
+            flushPartialTranscript()
+        } else if !displayScheduled {
+            DispatchQueue.main.asyncAfter(deadline: .now() + (partialTranscriptInterval - elapsed)) { [weak self] in
+                self?.flushPartialTranscript()
+            }
+        }
+    }
+    
+    private func flushPartialTranscript() {
+        guard let partialTranscript = pendingPartialTranscript else { return }
+        
+        let start = CACurrentMediaTime()
+        
+        updateText = partialTranscript.partialTranscript
+        
+        pendingPartialTranscript = nil
+        lastPartialTranscriptTime = CACurrentMediaTime()
+        partialTranscriptsDisplayed += 1
+        partialTranscriptDisplayTime += lastPartialTranscriptTime - start
+    }
+    
+    private func logPartialTranscriptDisplayTime() {
+        guard partialTranscriptsDisplayed > 0 else { return }
+        
+        // Without the rate limit every partial transcript received would have been displayed, at
+        // about the same cost each.
+        let unlimitedTime = partialTranscriptDisplayTime / Double(partialTranscriptsDisplayed) * Double(partialTranscriptsReceived)
+        
+        print("Displayed \(partialTranscriptsDisplayed) of \(partialTranscriptsReceived) partial transcripts in \(String(format: "%.1f", partialTranscriptDisplayTime * 1000)) ms on the main thread (about \(String(format: "%.1f", unlimitedTime * 1000)) ms without rate limiting)")
+    }
+    
+    // MARK: - Speculative Text Search
+    
+    private func speculate(with partialTranscript: HoundDataPartialTranscript) {
+        // Short commands are often fully transcribed well before the voice response arrives. Once
+        // a partial transcript has stayed the same for speculativeSearchInterval seconds, run a
+        // text search for it in parallel. If the final transcript matches, the text search result
+        // is used and the voice query is cancelled. Otherwise the text search is cancelled.
+        
+        guard speculativeSearchInterval > 0 else { return }
+        
+        let text = partialTranscript.partialTranscript
+        
+        if partialTranscript.done {
+            finalTranscript = text
+            finalTranscriptTime = CACurrentMediaTime()
+            
+            tryUseSpeculativeResult()
+            return
+        }
+        
+        guard !text.isEmpty, text != stablePartialText else { return }
+        
+        // The generation changes with every new partial, so a timer from before the text changed
+        // does not fire early if the text later changes back.
+        stablePartialText = text
+        stablePartialGeneration += 1
+        
+        let generation = stablePartialGeneration
+        
+        DispatchQueue.main.asyncAfter(deadline: .now() + speculativeSearchInterval) {
+            self.startSpeculativeSearch(text: text, generation: generation)
+        }
+    }
+    
+    private func startSpeculativeSearch(text: String, generation: Int) {
+        // Only search if the transcript has not changed since it was scheduled, and the voice
+        // query has not already produced its final transcript.
+        
+        guard query?.isActive == true, finalTranscript == nil, generation == stablePartialGeneration else { return }
+        
+        cancelSpeculativeSearch()
+        
+        // Configure the text search with the same RequestInfo as the voice query.
+        let speculativeQuery = HoundTextSearch.instance().newTextSearch(withSearchText: text)
+        configure(requestInfoBuilder: speculativeQuery.requestInfoBuilder)
+        
+        self.speculativeQuery = speculativeQuery
+        speculativeSearchesStarted += 1
+        
+        speculativeQuery.start { query, _, _ in
+            if query == self.speculativeQuery {
+                self.tryUseSpeculativeResult()
+            }
+        }
+    }
+    
+    private func tryUseSpeculativeResult() {
+        guard let speculativeQuery = speculativeQuery, let finalTranscript = finalTranscript, !usedSpeculativeResult else { return }
+        
+        // The user kept talking after the transcript looked stable, or the text search failed:
+        // let the voice query finish normally.
+        guard speculativeQuery.searchText?.caseInsensitiveCompare(finalTranscript) == .orderedSame, speculativeQuery.error == nil else {
+            cancelSpeculativeSearch()
+            return
+        }
+        
+        // Still waiting for the text search response
+        guard let response = speculativeQuery.response else { return }
+        
+        usedSpeculativeResult = true
+        speculativeSearchesUsed += 1
+        
+        print("Speculative text search used for \(speculativeSearchesUsed) of \(speculativeSearchesStarted) attempts")
+        
+        query?.cancel()
+        
+        // The text search result needs the same client-side completion as a voice search result.
+        tryUpdateQueryResponse(response)
+        
+        display(searchResult: response, dictionary: speculativeQuery.dictionary ?? [:])
+        
+        speculativeSpeechStarted = false
+        
+        speculativeQuery.speakResponse()
+        
+        refreshUI()
+        watchSpeculativeSpeech()
+    }
+    
+    // The text search that answered the current voice query is kept until it has been spoken.
+    private var speakingSpeculativeResult: Bool {
+        return usedSpeculativeResult && speculativeQuery != nil
+    }
+    
+    private func watchSpeculativeSpeech() {
+        // HoundTextSearchQuery does not report when it finishes speaking, so check isSpeaking
+        // periodically. Once the response has been spoken, refresh the UI and start any follow-up query.
+        // Speech can take a moment to start, so isSpeaking == false only means it has finished once it
+        // has been seen speaking, or once the canceled voice query has finished.
+        
+        DispatchQueue.main.asyncAfter(deadline: .now() + speculativeSpeechPollInterval) {
+            guard self.speakingSpeculativeResult else { return }
+            
+            let isSpeaking = self.speculativeQuery?.isSpeaking == true
+            
+            if isSpeaking {
+                self.speculativeSpeechStarted = true
+            }
+            
+            if isSpeaking || (!self.speculativeSpeechStarted && self.query?.state != .finished) {
+                self.watchSpeculativeSpeech()
+                return
+            }
+            
+            self.speculativeQuery = nil
+            
+            self.refreshUI()
+            self.startNextQuery()
+        }
+    }
+    
+    private func cancelSpeculativeSearch() {
+        let speculativeQuery = self.speculativeQuery
+        self.speculativeQuery = nil
+        
+        speculativeQuery?.cancel()
+        speculativeQuery?.stopSpeaking()
+    }
+    
     // MARK: - Client Integration Example
     
-    public func tryUpdateQueryResponse(_ query: HoundVoiceSearchQuery) {
+    public func tryUpdateQueryResponse(_ response: HoundDataHoundServer) {
         // Some HoundServer responses need information from the client before they are "complete"
         // For more general information, start here: https://www.houndify.com/docs#dynamic-responses
         
@@ -226,7 +569,7 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
         // "Clear the screen" to try it.
         
         // First, let's make sure we've got a ClientClearScreenCommand to work with.
-        let commandResult📦 = query.response?.allResults?.first
+        let commandResult📦 = response.allResults?.first
         
         // See HoundDataCommandResult-Extras.swift for the implementation of isClientClearScreenCommand
         guard let commandResult = commandResult📦, commandResult.isClientClearScreenCommand else {
@@ -318,6 +661,15 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
     }
     
     @IBAction func didTapStartButton(_ sender: AnyObject) {
+        // Stop a speculative text search response that is being spoken in place of the voice query's.
+        if speakingSpeculativeResult {
+            // Interrupting the response also declines to answer it.
+            nextQuery = nil
+            cancelSpeculativeSearch()
+            refreshUI()
+            return
+        }
+        
         guard let query👍 = query else {
             blankTextView()
             startSearch()
@@ -336,10 +688,12 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
                 resetTextView()
             
             case .searching:
-                query👍.cancel()
+                cancelSearch()
                 resetTextView()
             
             case .speaking:
+                // Interrupting the response also declines to answer it.
+                nextQuery = nil
                 query👍.stopSpeaking()
             
             default:
@@ -364,7 +718,9 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
     
     private var updateText: String? {
         didSet {
-            refreshTextView()
+            if !patchTextView(from: oldValue) {
+                refreshTextView()
+            }
         }
     }
     
@@ -397,6 +753,29 @@ class VoiceSearchViewController: UIViewController, UISearchBarDelegate, HoundVoi
         }
     }
     
+    private func patchTextView(from previousText: String?) -> Bool {
+        // Successive partial transcripts usually differ only at the end. If the text view is
+        // showing the previous transcript, replace just the part after the common prefix rather
+        // than resetting the whole text and laying it out again.
+        
+        guard responseText == nil,
+            let previousText = previousText, !previousText.isEmpty,
+            let updateText = updateText, !updateText.isEmpty,
+            textView.text == previousText else {
+            return false
+        }
+        
+        let previous = previousText as NSString
+        let stableLength = (previous.commonPrefix(with: updateText, options: .literal) as NSString).length
+        
+        guard stableLength > 0 else { return false }
+        
+        let changedRange = NSRange(location: stableLength, length: previous.length - stableLength)
+        textView.textStorage.replaceCharacters(in: changedRange, with: (updateText as NSString).substring(from: stableLength))
+        
+        return true
+    }
+    
     private func update(status: String?) {
         statusLabel.text = status
     }